@@ -0,0 +1,53 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <glob.h>
+
+#include "color_space.h"
+#include "chroma.h"
+#include "conversion.h"
+#include "thread_pool.h"
+
+// everything that stays the same from file to file
+typedef struct {
+    color_space from;
+    color_space to;
+    int input_file_count;
+    int output_file_count;
+    chroma_format output_chroma;
+    const conversion *conv;
+    thread_pool *pool;
+} batch_context;
+
+// names as given to -i/-o: a file for count 1, a <name.ext> pattern for count 3
+typedef struct {
+    filename input;
+    filename output;
+} batch_entry;
+
+typedef struct {
+    FILE *list;
+    glob_t paths;
+    bool globbed;
+    size_t next;
+    batch_entry single;
+    const char *suffix;
+    int output_file_count;
+} batch_source;
+
+void batch_source_single(batch_source *source, const char *input, const char *output);
+
+// a file with one "<input> <output>" pair per line, or failing that a glob of input files whose outputs
+// are written next to them as <name>_<suffix>.ppm/.pgm
+int batch_source_open(batch_source *source, const char *list, const char *suffix, int output_file_count);
+
+void batch_source_close(batch_source *source);
+
+// read, convert and write run on separate threads for consecutive entries, the buffers of every
+// stage are kept and reused; returns the number of entries that failed
+size_t batch_run(const batch_context *context, batch_source *source);
+
+#endif
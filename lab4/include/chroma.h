@@ -0,0 +1,24 @@
+#ifndef CHROMA_H
+#define CHROMA_H
+
+#include <stddef.h>
+
+struct picture;
+
+typedef enum {
+    CHROMA_444 = 0, CHROMA_422, CHROMA_420
+} chroma_format;
+
+int chroma_format_from_string(const char *s, chroma_format *format);
+
+size_t chroma_width(size_t width, chroma_format format);
+
+size_t chroma_height(size_t height, chroma_format format);
+
+int chroma_detect(const struct picture *luma, const struct picture *chroma, chroma_format *format);
+
+struct picture *chroma_downsample(const struct picture *plane, chroma_format format);
+
+struct picture *chroma_upsample(const struct picture *plane, size_t width, size_t height, chroma_format format);
+
+#endif
@@ -0,0 +1,23 @@
+#ifndef CIE_H
+#define CIE_H
+
+#include <stddef.h>
+
+#include "color_space.h"
+
+/*
+ * CIE XYZ and CIELAB against the D65 white point, RGB being sRGB-encoded.
+ * 8-bit encodings: XYZ holds X/Xn, Y/Yn, Z/Zn scaled to 0..255 (so white is 255, 255, 255),
+ * Lab holds L * 255 / 100, a + 128 and b + 128.
+ * The three planes must not overlap.
+ */
+
+void XYZ_from_rgb_planes(unsigned char *p1, unsigned char *p2, unsigned char *p3, size_t count);
+
+void XYZ_to_rgb_planes(unsigned char *p1, unsigned char *p2, unsigned char *p3, size_t count);
+
+void Lab_from_rgb_planes(unsigned char *p1, unsigned char *p2, unsigned char *p3, size_t count);
+
+void Lab_to_rgb_planes(unsigned char *p1, unsigned char *p2, unsigned char *p3, size_t count);
+
+#endif
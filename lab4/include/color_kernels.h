@@ -0,0 +1,44 @@
+#ifndef COLOR_KERNELS_H
+#define COLOR_KERNELS_H
+
+#include <stddef.h>
+
+#include "color_space.h"
+
+typedef void (*affine_planes_func)(const affine_transform *t, unsigned char *p1, unsigned char *p2,
+                                   unsigned char *p3, size_t count);
+
+void affine_planes_scalar(const affine_transform *t, unsigned char *p1, unsigned char *p2, unsigned char *p3,
+                          size_t count);
+
+void affine_planes_sse2(const affine_transform *t, unsigned char *p1, unsigned char *p2, unsigned char *p3,
+                        size_t count);
+
+void affine_planes_avx2(const affine_transform *t, unsigned char *p1, unsigned char *p2, unsigned char *p3,
+                        size_t count);
+
+// avx2, else sse2, else scalar, by what the running cpu has; only scalar off x86
+affine_planes_func affine_planes_kernel(void);
+
+void affine_planes(const affine_transform *t, unsigned char *p1, unsigned char *p2, unsigned char *p3,
+                   size_t count);
+
+void deinterleave_rgb_scalar(const unsigned char *src, unsigned char *p1, unsigned char *p2, unsigned char *p3,
+                             size_t count);
+
+void deinterleave_rgb_ssse3(const unsigned char *src, unsigned char *p1, unsigned char *p2, unsigned char *p3,
+                            size_t count);
+
+void deinterleave_rgb(const unsigned char *src, unsigned char *p1, unsigned char *p2, unsigned char *p3,
+                      size_t count);
+
+void interleave_rgb_scalar(const unsigned char *p1, const unsigned char *p2, const unsigned char *p3,
+                           unsigned char *dst, size_t count);
+
+void interleave_rgb_ssse3(const unsigned char *p1, const unsigned char *p2, const unsigned char *p3,
+                          unsigned char *dst, size_t count);
+
+void interleave_rgb(const unsigned char *p1, const unsigned char *p2, const unsigned char *p3, unsigned char *dst,
+                    size_t count);
+
+#endif
@@ -4,7 +4,7 @@
 struct picture;
 
 typedef enum {
-    RGB = 0, HSL, HSV, YCbCr_601, YCbCr_709, YCoCg, CMY
+    RGB = 0, HSL, HSV, YCbCr_601, YCbCr_709, YCoCg, CMY, YCoCg_R, XYZ, Lab
 } color_space;
 
 typedef struct {
@@ -15,6 +15,10 @@ typedef struct {
     struct picture *sources[3];
 } color_sources;
 
+typedef struct {
+    float m[3][4];
+} affine_transform;
+
 typedef void (*to_rgb_pixel_func)(unsigned char *s1, unsigned char *s2, unsigned char *s3);
 
 typedef void (*from_rgb_pixel_func)(unsigned char *s1, unsigned char *s2, unsigned char *s3);
@@ -31,6 +35,10 @@ void YCoCg_to_rgb_pixel(unsigned char *s1, unsigned char *s2, unsigned char *s3)
 
 void CMY_to_rgb_pixel(unsigned char *s1, unsigned char *s2, unsigned char *s3);
 
+void XYZ_to_rgb_pixel(unsigned char *s1, unsigned char *s2, unsigned char *s3);
+
+void Lab_to_rgb_pixel(unsigned char *s1, unsigned char *s2, unsigned char *s3);
+
 static void noop(unsigned char *s1, unsigned char *s2, unsigned char *s3) {}
 
 void hsl_from_rgb_pixel(unsigned char *s1, unsigned char *s2, unsigned char *s3);
@@ -45,4 +53,16 @@ void YCoCg_from_rgb_pixel(unsigned char *s1, unsigned char *s2, unsigned char *s
 
 void CMY_from_rgb_pixel(unsigned char *s1, unsigned char *s2, unsigned char *s3);
 
+void XYZ_from_rgb_pixel(unsigned char *s1, unsigned char *s2, unsigned char *s3);
+
+void Lab_from_rgb_pixel(unsigned char *s1, unsigned char *s2, unsigned char *s3);
+
+void affine_pixel(const affine_transform *t, unsigned char *s1, unsigned char *s2, unsigned char *s3);
+
+const affine_transform *to_rgb_affine(color_space space);
+
+const affine_transform *from_rgb_affine(color_space space);
+
+void affine_compose(const affine_transform *outer, const affine_transform *inner, affine_transform *out);
+
 #endif
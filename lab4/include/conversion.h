@@ -0,0 +1,54 @@
+#ifndef CONVERSION_H
+#define CONVERSION_H
+
+#include <stddef.h>
+
+#include "color_space.h"
+#include "color_kernels.h"
+#include "ycc_fixed.h"
+#include "lut3d.h"
+#include "thread_pool.h"
+
+typedef enum {
+    FIXED_POINT = 0, FLOATING_POINT
+} arithmetic;
+
+typedef enum {
+    CONVERT_COPY = 0, CONVERT_LUT, CONVERT_YCC_FROM_RGB, CONVERT_YCC_TO_RGB, CONVERT_AFFINE, CONVERT_TWO_STAGE
+} conversion_kind;
+
+typedef struct {
+    conversion_kind kind;
+    color_space from;
+    color_space to;
+    const lut3d *lut;
+    ycc_tables ycc;
+    affine_transform affine;
+    affine_planes_func affine_kernel;
+} conversion;
+
+extern const char *const color_space_names[];
+
+extern const to_rgb_pixel_func to_rgb_funcs[];
+
+extern const from_rgb_pixel_func from_rgb_funcs[];
+
+int prepare_lut(lut3d *lut, int size, color_space from, color_space to, const char *cache_dir);
+
+void conversion_init(conversion *conv, color_space from, color_space to, arithmetic arithmetic, const lut3d *lut);
+
+void conversion_apply(const conversion *conv, unsigned char *p1, unsigned char *p2, unsigned char *p3,
+                      size_t count);
+
+// converts packed P6 pixels through small stack blocks instead of full-size planes
+void conversion_apply_interleaved(const conversion *conv, unsigned char *pixels, size_t count);
+
+// row-partitioned versions of the two above, every pixel is converted independently so the result
+// doesn't depend on the thread count
+void conversion_apply_rows(thread_pool *pool, const conversion *conv, unsigned char *p1, unsigned char *p2,
+                           unsigned char *p3, size_t width, size_t height);
+
+void conversion_apply_interleaved_rows(thread_pool *pool, const conversion *conv, unsigned char *pixels,
+                                       size_t width, size_t height);
+
+#endif
@@ -0,0 +1,36 @@
+#ifndef LUT3D_H
+#define LUT3D_H
+
+#include <stddef.h>
+
+#include "color_space.h"
+
+#define LUT3D_EXACT 256
+// baked tables depend on the conversion code, so a change to it must bump the version of the cached files
+#define LUT3D_VERSION 2
+#define LUT3D_WEIGHT_BITS 8
+#define LUT3D_WEIGHT_ONE (1 << LUT3D_WEIGHT_BITS)
+
+typedef struct {
+    // grid points per axis: 17, 33, 65 or LUT3D_EXACT for a table entry per input colour
+    int size;
+    // for every 8-bit input the grid cell it falls into and its position inside the cell in
+    // [0, LUT3D_WEIGHT_ONE], 255 is the far end of the last cell
+    unsigned short cell[256];
+    unsigned short weight[256];
+    unsigned char *data;
+} lut3d;
+
+int lut3d_valid_size(int size);
+
+int lut3d_bake(lut3d *lut, int size, to_rgb_pixel_func to, from_rgb_pixel_func from);
+
+int lut3d_load(lut3d *lut, const char *path);
+
+int lut3d_save(const lut3d *lut, const char *path);
+
+void lut3d_free(lut3d *lut);
+
+void lut3d_apply_planes(const lut3d *lut, unsigned char *p1, unsigned char *p2, unsigned char *p3, size_t count);
+
+#endif
@@ -0,0 +1,65 @@
+#ifndef PLANE_IO_H
+#define PLANE_IO_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#include "picture.h"
+#include "color_space.h"
+
+typedef struct plane_reader plane_reader;
+
+typedef struct {
+    plane_reader *reader;
+    int index;
+} plane_read_job;
+
+struct plane_reader {
+    FILE *files[3];
+    picture *planes[3];
+    size_t loaded[3];
+    int status[3];
+    plane_read_job jobs[3];
+    pthread_t threads[3];
+    bool started[3];
+
+    pthread_mutex_t mutex;
+    pthread_cond_t progress;
+};
+
+// splits <name.ext> into <name_1.ext>, <name_2.ext> and <name_3.ext>
+int plane_file_names(const char *pattern, filename names[3]);
+
+size_t picture_bytes(const picture *pic);
+
+// makes *pic hold at least size bytes of data, keeping the old buffer when it is big enough;
+// *capacity tracks the allocation and starts at 0 with *pic == NULL
+picture *reserve_picture(picture **pic, size_t *capacity, size_t size);
+
+// parses the header into a picture reserved as above, the file is left positioned at the pixel data
+int open_picture(const char *name, FILE **file, picture **pic, size_t *capacity);
+
+int read_picture(const char *name, picture **pic, size_t *capacity);
+
+int write_picture(picture *pic, const char *name);
+
+// writes the three planes concurrently, one file each
+int write_planes(picture *const planes[3], const filename names[3]);
+
+// opens all three files and parses their headers into planes reserved as above, so sizes can be checked
+// before any pixel data is read; the planes stay with the caller even though the reader keeps filling them
+int plane_reader_open(plane_reader *reader, const filename names[3], picture *planes[3], size_t capacity[3]);
+
+// starts one thread per plane
+void plane_reader_start(plane_reader *reader);
+
+// waits until the first rows rows of every plane are in memory (or reading stopped) and returns the number
+// of rows all three planes have, meant for planes of equal size
+size_t plane_reader_wait_rows(plane_reader *reader, size_t rows);
+
+// joins the threads and closes the files, returns the first error
+int plane_reader_finish(plane_reader *reader);
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef YCC_FIXED_H
+#define YCC_FIXED_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "color_space.h"
+
+#define YCC_SCALEBITS 16
+
+typedef struct {
+    double r_y, g_y, b_y;
+    double r_cb, g_cb;
+    double g_cr, b_cr;
+    double cr_r, cb_b;
+    double cr_g, cb_g;
+} ycc_coefficients;
+
+typedef struct {
+    int32_t r_y[256];
+    int32_t g_y[256];
+    int32_t b_y[256];
+    int32_t r_cb[256];
+    int32_t g_cb[256];
+    int32_t b_cb[256];
+    int32_t g_cr[256];
+    int32_t b_cr[256];
+
+    int cr_r[256];
+    int cb_b[256];
+    int32_t cr_g[256];
+    int32_t cb_g[256];
+
+    unsigned char range_limit[3 * 256];
+} ycc_tables;
+
+void ycc_tables_init(ycc_tables *tables, const ycc_coefficients *k);
+
+int ycc_tables_for(color_space space, ycc_tables *tables);
+
+void ycc_from_rgb_planes(const ycc_tables *tables, unsigned char *p1, unsigned char *p2, unsigned char *p3,
+                         size_t count);
+
+void ycc_to_rgb_planes(const ycc_tables *tables, unsigned char *p1, unsigned char *p2, unsigned char *p3,
+                       size_t count);
+
+#endif
@@ -0,0 +1,28 @@
+#ifndef YCOCG_R_H
+#define YCOCG_R_H
+
+#include <stddef.h>
+
+#include "thread_pool.h"
+
+// Co and Cg are 9-bit signed values, stored with this offset as 16-bit samples of a pgm with max_color 511
+#define YCOCG_R_CHROMA_OFFSET 256
+#define YCOCG_R_CHROMA_MAX 511
+
+// co and cg point to 2 * count bytes of big-endian samples (the pgm layout), y may alias r
+void ycocg_r_from_rgb_planes(const unsigned char *r, const unsigned char *g, const unsigned char *b,
+                             unsigned char *y, unsigned char *co, unsigned char *cg, size_t count);
+
+// r may alias y
+void ycocg_r_to_rgb_planes(const unsigned char *y, const unsigned char *co, const unsigned char *cg,
+                           unsigned char *r, unsigned char *g, unsigned char *b, size_t count);
+
+void ycocg_r_from_rgb_rows(thread_pool *pool, const unsigned char *r, const unsigned char *g,
+                           const unsigned char *b, unsigned char *y, unsigned char *co, unsigned char *cg,
+                           size_t width, size_t height);
+
+void ycocg_r_to_rgb_rows(thread_pool *pool, const unsigned char *y, const unsigned char *co,
+                         const unsigned char *cg, unsigned char *r, unsigned char *g, unsigned char *b,
+                         size_t width, size_t height);
+
+#endif
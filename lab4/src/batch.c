@@ -0,0 +1,458 @@
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <glob.h>
+
+#include "../include/batch.h"
+#include "../include/picture.h"
+#include "../include/color_kernels.h"
+#include "../include/conversion.h"
+#include "../include/chroma.h"
+#include "../include/ycocg_r.h"
+#include "../include/plane_io.h"
+#include "../include/defines.h"
+
+// one entry being read, one converted and one written
+#define BATCH_SLOTS 3
+
+typedef struct {
+    batch_entry entry;
+    int status;
+    bool converted;
+
+    plane_reader reader;
+    bool reading;
+    chroma_format input_chroma;
+
+    picture *packed;
+    size_t packed_capacity;
+    picture *planes[3];
+    size_t plane_capacity[3];
+    picture *scratch[2];
+    size_t scratch_capacity[2];
+    picture *subsampled[3];
+} batch_slot;
+
+typedef struct {
+    const batch_context *context;
+    batch_source *source;
+    batch_slot slots[BATCH_SLOTS];
+
+    pthread_mutex_t mutex;
+    pthread_cond_t changed;
+    size_t loaded;
+    size_t converted;
+    size_t written;
+    bool loading_done;
+    bool converting_done;
+    size_t failed;
+} pipeline;
+
+void batch_source_single(batch_source *source, const char *input, const char *output) {
+    memset(source, 0, sizeof(*source));
+    snprintf(source->single.input.data, sizeof(source->single.input.data), "%s", input);
+    snprintf(source->single.output.data, sizeof(source->single.output.data), "%s", output);
+}
+
+int batch_source_open(batch_source *source, const char *list, const char *suffix, int output_file_count) {
+    memset(source, 0, sizeof(*source));
+    source->suffix = suffix;
+    source->output_file_count = output_file_count;
+    source->next = 1;
+
+    source->list = fopen(list, "r");
+    if (source->list)
+        return SUCCESS;
+
+    if (glob(list, 0, NULL, &source->paths) != 0)
+        return FILE_ERROR;
+    source->globbed = true;
+    source->next = 0;
+    return SUCCESS;
+}
+
+void batch_source_close(batch_source *source) {
+    if (source->list)
+        fclose(source->list);
+    if (source->globbed)
+        globfree(&source->paths);
+}
+
+static bool output_name_for(const batch_source *source, const char *input, filename *output) {
+    const char *dot = strrchr(input, '.');
+    const char *slash = strrchr(input, '/');
+    const size_t stem = dot != NULL && (slash == NULL || dot > slash) ? (size_t) (dot - input) : strlen(input);
+    const int n = snprintf(output->data, sizeof(output->data), "%.*s_%s.%s", (int) stem, input, source->suffix,
+                           source->output_file_count == 1 ? "ppm" : "pgm");
+    return n > 0 && n < (int) sizeof(output->data);
+}
+
+// only the loader thread pulls entries, so a list of millions of files is never held in memory at once
+static bool next_entry(batch_source *source, batch_entry *entry) {
+    if (source->globbed) {
+        while (source->next < source->paths.gl_pathc) {
+            const char *input = source->paths.gl_pathv[source->next++];
+            if (snprintf(entry->input.data, sizeof(entry->input.data), "%s", input) <
+                (int) sizeof(entry->input.data) && output_name_for(source, input, &entry->output))
+                return true;
+            fprintf(stderr, "name too long: %s\n", input);
+        }
+        return false;
+    }
+
+    if (source->list) {
+        char line[2 * sizeof(filename) + 2];
+        while (fgets(line, sizeof(line), source->list)) {
+            char extra;
+            const int n = sscanf(line, "%255s %255s %c", entry->input.data, entry->output.data, &extra);
+            if (n == 2)
+                return true;
+            if (n > 0)
+                fprintf(stderr, "can't parse batch line: %s", line);
+        }
+        return false;
+    }
+
+    if (source->next++ == 0) {
+        *entry = source->single;
+        return true;
+    }
+    return false;
+}
+
+static void fail(batch_slot *slot, int ret, const char *what, const char *name) {
+    slot->status = ret;
+    fprintf(stderr, "%s: %s %s.\n", ret == NOMEM ? "no mem" : ret == FILE_ERROR ? "file error" :
+                                     ret == PARSE_ERROR ? "wrong file format" :
+                                     ret == LOGIC_ERROR ? "wrong size" : "no reason", what, name);
+}
+
+static void load_entry(const batch_context *context, batch_slot *slot) {
+    slot->status = SUCCESS;
+    slot->converted = false;
+    slot->reading = false;
+    int ret;
+
+    if (context->input_file_count == 1) {
+        if ((ret = read_picture(slot->entry.input.data, &slot->packed, &slot->packed_capacity)) != SUCCESS) {
+            fail(slot, ret, "can't read input file", slot->entry.input.data);
+            return;
+        }
+        if (slot->packed->type != P6) {
+            fail(slot, PARSE_ERROR, "expected a P6 input file", slot->entry.input.data);
+        }
+        return;
+    }
+
+    filename names[3];
+    if ((ret = plane_file_names(slot->entry.input.data, names)) != SUCCESS ||
+        (ret = plane_reader_open(&slot->reader, names, slot->planes, slot->plane_capacity)) != SUCCESS) {
+        fail(slot, ret, "can't read input files", slot->entry.input.data);
+        return;
+    }
+    slot->reading = true;
+
+    picture *const *planes = slot->planes;
+    chroma_format check;
+    if (planes[0]->type != P5 || planes[1]->type != P5 || planes[2]->type != P5) {
+        fail(slot, PARSE_ERROR, "expected three P5 input files", slot->entry.input.data);
+    } else if (chroma_detect(planes[0], planes[1], &slot->input_chroma) != SUCCESS ||
+               chroma_detect(planes[0], planes[2], &check) != SUCCESS || check != slot->input_chroma) {
+        fail(slot, LOGIC_ERROR, "input planes have incompatible sizes", slot->entry.input.data);
+    } else if (context->from == YCoCg_R && (slot->input_chroma != CHROMA_444 || planes[0]->pixel_size != 1 ||
+                                            planes[1]->pixel_size != 2 || planes[2]->pixel_size != 2)) {
+        fail(slot, LOGIC_ERROR, "YCoCg_R expects a full-size 8-bit Y plane and 16-bit Co/Cg planes",
+             slot->entry.input.data);
+    }
+
+    if (slot->status != SUCCESS) {
+        slot->reading = false;
+        plane_reader_finish(&slot->reader);
+        return;
+    }
+    plane_reader_start(&slot->reader);
+}
+
+static picture *reserve_plane(picture **plane, size_t *capacity, const picture *like, int max_color,
+                              int pixel_size) {
+    picture *result = reserve_picture(plane, capacity, like->width * like->height * pixel_size);
+    if (result) {
+        result->width = like->width;
+        result->height = like->height;
+        result->max_color = max_color;
+        result->pixel_size = pixel_size;
+        result->type = P5;
+    }
+    return result;
+}
+
+static void swap_scratch(batch_slot *slot, int plane, int scratch) {
+    picture *pic = slot->planes[plane];
+    const size_t capacity = slot->plane_capacity[plane];
+    slot->planes[plane] = slot->scratch[scratch];
+    slot->plane_capacity[plane] = slot->scratch_capacity[scratch];
+    slot->scratch[scratch] = pic;
+    slot->scratch_capacity[scratch] = capacity;
+}
+
+static void convert_entry(const batch_context *context, batch_slot *slot) {
+    const conversion *conv = context->conv;
+    picture **planes = slot->planes;
+    int ret;
+
+    if (slot->status != SUCCESS)
+        return;
+
+    if (context->input_file_count == 1 && context->output_file_count == 1) {
+        conversion_apply_interleaved_rows(context->pool, conv, slot->packed->data, slot->packed->width,
+                                          slot->packed->height);
+        return;
+    }
+
+    if (context->input_file_count == 3) {
+        if (slot->input_chroma == CHROMA_444 && context->from != YCoCg_R) {
+            // convert the rows all three planes already have while the rest is still being read
+            const size_t width = planes[0]->width;
+            const size_t height = planes[0]->height;
+            size_t done = 0;
+            while (done < height) {
+                const size_t rows = plane_reader_wait_rows(&slot->reader, done + 1);
+                const size_t offset = done * width;
+                conversion_apply_rows(context->pool, conv, planes[0]->data + offset, planes[1]->data + offset,
+                                      planes[2]->data + offset, width, rows - done);
+                done = rows;
+            }
+            slot->converted = true;
+        }
+        slot->reading = false;
+        if ((ret = plane_reader_finish(&slot->reader)) != SUCCESS) {
+            fail(slot, ret, "can't read input files", slot->entry.input.data);
+            return;
+        }
+
+        for (int i = 1; i < 3 && slot->input_chroma != CHROMA_444; ++i) {
+            picture *upsampled = chroma_upsample(planes[i], planes[0]->width, planes[0]->height,
+                                                 slot->input_chroma);
+            if (!upsampled) {
+                fail(slot, NOMEM, "can't upsample", slot->entry.input.data);
+                return;
+            }
+            free(planes[i]);
+            planes[i] = upsampled;
+            slot->plane_capacity[i] = picture_bytes(upsampled);
+        }
+
+        if (context->from == YCoCg_R) {
+            if (!reserve_plane(&slot->scratch[0], &slot->scratch_capacity[0], planes[0], planes[0]->max_color, 1) ||
+                !reserve_plane(&slot->scratch[1], &slot->scratch_capacity[1], planes[0], planes[0]->max_color, 1)) {
+                fail(slot, NOMEM, "can't convert", slot->entry.input.data);
+                return;
+            }
+            ycocg_r_to_rgb_rows(context->pool, planes[0]->data, planes[1]->data, planes[2]->data, planes[0]->data,
+                                slot->scratch[0]->data, slot->scratch[1]->data, planes[0]->width,
+                                planes[0]->height);
+            swap_scratch(slot, 1, 0);
+            swap_scratch(slot, 2, 1);
+        }
+    } else {
+        const picture *packed = slot->packed;
+        for (int i = 0; i < 3; ++i) {
+            if (!reserve_plane(&planes[i], &slot->plane_capacity[i], packed, packed->max_color, 1)) {
+                fail(slot, NOMEM, "can't convert", slot->entry.input.data);
+                return;
+            }
+        }
+        deinterleave_rgb(packed->data, planes[0]->data, planes[1]->data, planes[2]->data,
+                         packed->width * packed->height);
+    }
+
+    if (!slot->converted)
+        conversion_apply_rows(context->pool, conv, planes[0]->data, planes[1]->data, planes[2]->data,
+                              planes[0]->width, planes[0]->height);
+
+    if (context->output_file_count == 1) {
+        picture *packed = reserve_picture(&slot->packed, &slot->packed_capacity,
+                                          3 * planes[0]->width * planes[0]->height);
+        if (!packed) {
+            fail(slot, NOMEM, "can't convert", slot->entry.input.data);
+            return;
+        }
+        packed->width = planes[0]->width;
+        packed->height = planes[0]->height;
+        packed->max_color = planes[0]->max_color;
+        packed->pixel_size = planes[0]->pixel_size;
+        packed->type = P6;
+        interleave_rgb(planes[0]->data, planes[1]->data, planes[2]->data, packed->data,
+                       packed->width * packed->height);
+        return;
+    }
+
+    if (context->to == YCoCg_R) {
+        for (int i = 0; i < 2; ++i) {
+            if (!reserve_plane(&slot->scratch[i], &slot->scratch_capacity[i], planes[0], YCOCG_R_CHROMA_MAX, 2)) {
+                fail(slot, NOMEM, "can't convert", slot->entry.input.data);
+                return;
+            }
+        }
+        ycocg_r_from_rgb_rows(context->pool, planes[0]->data, planes[1]->data, planes[2]->data, planes[0]->data,
+                              slot->scratch[0]->data, slot->scratch[1]->data, planes[0]->width, planes[0]->height);
+        swap_scratch(slot, 1, 0);
+        swap_scratch(slot, 2, 1);
+    }
+
+    for (int i = 1; i < 3 && context->output_chroma != CHROMA_444; ++i) {
+        slot->subsampled[i] = chroma_downsample(planes[i], context->output_chroma);
+        if (!slot->subsampled[i]) {
+            fail(slot, NOMEM, "can't downsample", slot->entry.input.data);
+            return;
+        }
+    }
+}
+
+static void write_entry(const batch_context *context, batch_slot *slot) {
+    if (slot->status == SUCCESS) {
+        int ret;
+        if (context->output_file_count == 1) {
+            ret = write_picture(slot->packed, slot->entry.output.data);
+        } else {
+            filename names[3];
+            picture *planes[3];
+            for (int i = 0; i < 3; ++i) {
+                planes[i] = slot->subsampled[i] ? slot->subsampled[i] : slot->planes[i];
+            }
+            if ((ret = plane_file_names(slot->entry.output.data, names)) == SUCCESS)
+                ret = write_planes(planes, names);
+        }
+        if (ret != SUCCESS)
+            fail(slot, ret, "can't write", slot->entry.output.data);
+    }
+
+    for (int i = 0; i < 3; ++i) {
+        free(slot->subsampled[i]);
+        slot->subsampled[i] = NULL;
+    }
+}
+
+static void *loader_main(void *arg) {
+    pipeline *p = arg;
+    for (size_t k = 0;; ++k) {
+        pthread_mutex_lock(&p->mutex);
+        while (k - p->written >= BATCH_SLOTS) {
+            pthread_cond_wait(&p->changed, &p->mutex);
+        }
+        pthread_mutex_unlock(&p->mutex);
+
+        batch_slot *slot = &p->slots[k % BATCH_SLOTS];
+        const bool more = next_entry(p->source, &slot->entry);
+        if (more)
+            load_entry(p->context, slot);
+
+        pthread_mutex_lock(&p->mutex);
+        if (more)
+            p->loaded = k + 1;
+        else
+            p->loading_done = true;
+        pthread_cond_broadcast(&p->changed);
+        pthread_mutex_unlock(&p->mutex);
+        if (!more)
+            return NULL;
+    }
+}
+
+static void *writer_main(void *arg) {
+    pipeline *p = arg;
+    for (size_t k = 0;; ++k) {
+        pthread_mutex_lock(&p->mutex);
+        while (k >= p->converted && !p->converting_done) {
+            pthread_cond_wait(&p->changed, &p->mutex);
+        }
+        const bool more = k < p->converted;
+        pthread_mutex_unlock(&p->mutex);
+        if (!more)
+            return NULL;
+
+        batch_slot *slot = &p->slots[k % BATCH_SLOTS];
+        write_entry(p->context, slot);
+
+        pthread_mutex_lock(&p->mutex);
+        if (slot->status != SUCCESS)
+            ++p->failed;
+        p->written = k + 1;
+        pthread_cond_broadcast(&p->changed);
+        pthread_mutex_unlock(&p->mutex);
+    }
+}
+
+static void free_slot(batch_slot *slot) {
+    free(slot->packed);
+    for (int i = 0; i < 3; ++i) {
+        free(slot->planes[i]);
+        free(slot->subsampled[i]);
+    }
+    free(slot->scratch[0]);
+    free(slot->scratch[1]);
+}
+
+size_t batch_run(const batch_context *context, batch_source *source) {
+    pipeline p = {.context = context, .source = source};
+    pthread_mutex_init(&p.mutex, NULL);
+    pthread_cond_init(&p.changed, NULL);
+
+    pthread_t loader;
+    pthread_t writer;
+    const bool loader_started = pthread_create(&loader, NULL, loader_main, &p) == 0;
+    const bool writer_started = loader_started && pthread_create(&writer, NULL, writer_main, &p) == 0;
+
+    if (!loader_started) {
+        batch_slot *slot = &p.slots[0];
+        while (next_entry(source, &slot->entry)) {
+            load_entry(context, slot);
+            convert_entry(context, slot);
+            write_entry(context, slot);
+            if (slot->status != SUCCESS)
+                ++p.failed;
+        }
+    } else {
+        // the calling thread converts, so the pool is only ever driven from here
+        for (size_t k = 0;; ++k) {
+            pthread_mutex_lock(&p.mutex);
+            while (k >= p.loaded && !p.loading_done) {
+                pthread_cond_wait(&p.changed, &p.mutex);
+            }
+            const bool more = k < p.loaded;
+            pthread_mutex_unlock(&p.mutex);
+            if (!more)
+                break;
+
+            batch_slot *slot = &p.slots[k % BATCH_SLOTS];
+            convert_entry(context, slot);
+            if (!writer_started)
+                write_entry(context, slot);
+
+            pthread_mutex_lock(&p.mutex);
+            p.converted = k + 1;
+            if (!writer_started) {
+                if (slot->status != SUCCESS)
+                    ++p.failed;
+                p.written = k + 1;
+            }
+            pthread_cond_broadcast(&p.changed);
+            pthread_mutex_unlock(&p.mutex);
+        }
+
+        pthread_mutex_lock(&p.mutex);
+        p.converting_done = true;
+        pthread_cond_broadcast(&p.changed);
+        pthread_mutex_unlock(&p.mutex);
+        pthread_join(loader, NULL);
+        if (writer_started)
+            pthread_join(writer, NULL);
+    }
+
+    for (int i = 0; i < BATCH_SLOTS; ++i) {
+        free_slot(&p.slots[i]);
+    }
+    pthread_cond_destroy(&p.changed);
+    pthread_mutex_destroy(&p.mutex);
+    return p.failed;
+}
@@ -0,0 +1,166 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "../include/chroma.h"
+#include "../include/picture.h"
+#include "../include/defines.h"
+
+/*
+ * Chroma samples are sited between the luma samples they cover (JPEG/MPEG-1 style). Downsampling uses
+ * the [1 3 3 1] / 8 filter around that point along each halved axis, upsampling is the matching
+ * triangle filter (3/4 of the nearest chroma sample and 1/4 of the next one), as in libjpeg's fancy
+ * upsampling.
+ */
+
+int chroma_format_from_string(const char *s, chroma_format *format) {
+    if (!strcmp(s, "444")) {
+        *format = CHROMA_444;
+    } else if (!strcmp(s, "422")) {
+        *format = CHROMA_422;
+    } else if (!strcmp(s, "420")) {
+        *format = CHROMA_420;
+    } else {
+        return PARSE_ERROR;
+    }
+    return SUCCESS;
+}
+
+size_t chroma_width(size_t width, chroma_format format) {
+    return format == CHROMA_444 ? width : (width + 1) / 2;
+}
+
+size_t chroma_height(size_t height, chroma_format format) {
+    return format == CHROMA_420 ? (height + 1) / 2 : height;
+}
+
+int chroma_detect(const picture *luma, const picture *chroma, chroma_format *format) {
+    static const chroma_format formats[] = {CHROMA_444, CHROMA_422, CHROMA_420};
+    for (size_t i = 0; i < sizeof(formats) / sizeof(formats[0]); ++i) {
+        if (chroma->width == chroma_width(luma->width, formats[i]) &&
+            chroma->height == chroma_height(luma->height, formats[i])) {
+            *format = formats[i];
+            return SUCCESS;
+        }
+    }
+    return LOGIC_ERROR;
+}
+
+static picture *plane_like(const picture *plane, size_t width, size_t height) {
+    picture *result = malloc(sizeof(picture) + width * height);
+    if (!result) {
+        return NULL;
+    }
+    result->width = width;
+    result->height = height;
+    result->type = P5;
+    result->max_color = plane->max_color;
+    result->pixel_size = 1;
+    return result;
+}
+
+static size_t clamp_index(ptrdiff_t i, size_t size) {
+    return i < 0 ? 0 : ((size_t) i >= size ? size - 1 : (size_t) i);
+}
+
+picture *chroma_downsample(const picture *plane, chroma_format format) {
+    const size_t w = plane->width;
+    const size_t h = plane->height;
+    const size_t cw = chroma_width(w, format);
+    const size_t ch = chroma_height(h, format);
+
+    picture *result = plane_like(plane, cw, ch);
+    if (!result || format == CHROMA_444) {
+        if (result)
+            memcpy(result->data, plane->data, w * h);
+        return result;
+    }
+
+    // horizontal pass, sums scaled by 8
+    uint16_t *rows = malloc(cw * h * sizeof(uint16_t));
+    if (!rows) {
+        free(result);
+        return NULL;
+    }
+    for (size_t y = 0; y < h; ++y) {
+        const unsigned char *src = plane->data + y * w;
+        uint16_t *dst = rows + y * cw;
+        for (size_t x = 0; x < cw; ++x) {
+            const ptrdiff_t c = (ptrdiff_t) (2 * x);
+            dst[x] = src[clamp_index(c - 1, w)] + 3 * src[clamp_index(c, w)] +
+                     3 * src[clamp_index(c + 1, w)] + src[clamp_index(c + 2, w)];
+        }
+    }
+
+    if (format == CHROMA_422) {
+        for (size_t i = 0; i < cw * h; ++i) {
+            result->data[i] = (rows[i] + 4) >> 3;
+        }
+    } else {
+        for (size_t y = 0; y < ch; ++y) {
+            const ptrdiff_t c = (ptrdiff_t) (2 * y);
+            const uint16_t *r0 = rows + clamp_index(c - 1, h) * cw;
+            const uint16_t *r1 = rows + clamp_index(c, h) * cw;
+            const uint16_t *r2 = rows + clamp_index(c + 1, h) * cw;
+            const uint16_t *r3 = rows + clamp_index(c + 2, h) * cw;
+            unsigned char *dst = result->data + y * cw;
+            for (size_t x = 0; x < cw; ++x) {
+                dst[x] = (r0[x] + 3 * r1[x] + 3 * r2[x] + r3[x] + 32) >> 6;
+            }
+        }
+    }
+
+    free(rows);
+    return result;
+}
+
+picture *chroma_upsample(const picture *plane, size_t width, size_t height, chroma_format format) {
+    const size_t cw = plane->width;
+    const size_t ch = plane->height;
+
+    picture *result = plane_like(plane, width, height);
+    if (!result || format == CHROMA_444) {
+        if (result)
+            memcpy(result->data, plane->data, width * height);
+        return result;
+    }
+
+    // vertical pass, sums scaled by 4 for 4:2:0 and left as is for 4:2:2
+    uint16_t *cols = malloc(cw * height * sizeof(uint16_t));
+    if (!cols) {
+        free(result);
+        return NULL;
+    }
+    for (size_t y = 0; y < height; ++y) {
+        uint16_t *dst = cols + y * cw;
+        if (format == CHROMA_422) {
+            const unsigned char *src = plane->data + y * cw;
+            for (size_t x = 0; x < cw; ++x) {
+                dst[x] = src[x];
+            }
+        } else {
+            const size_t i = y / 2;
+            const size_t nb = clamp_index(y % 2 ? (ptrdiff_t) i + 1 : (ptrdiff_t) i - 1, ch);
+            const unsigned char *near = plane->data + i * cw;
+            const unsigned char *far = plane->data + nb * cw;
+            for (size_t x = 0; x < cw; ++x) {
+                dst[x] = 3 * near[x] + far[x];
+            }
+        }
+    }
+
+    const int shift = format == CHROMA_420 ? 4 : 2;
+    const int round = 1 << (shift - 1);
+    for (size_t y = 0; y < height; ++y) {
+        const uint16_t *src = cols + y * cw;
+        unsigned char *dst = result->data + y * width;
+        for (size_t x = 0; x < width; ++x) {
+            const size_t i = x / 2;
+            const size_t nb = clamp_index(x % 2 ? (ptrdiff_t) i + 1 : (ptrdiff_t) i - 1, cw);
+            dst[x] = (3 * src[i] + src[nb] + round) >> shift;
+        }
+    }
+
+    free(cols);
+    return result;
+}
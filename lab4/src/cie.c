@@ -0,0 +1,173 @@
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "../include/cie.h"
+#include "../include/color_space.h"
+
+// D65 white
+#define WHITE_X 0.95047
+#define WHITE_Y 1.00000
+#define WHITE_Z 1.08883
+
+// (6/29)^3 and the slope/offset of the linear part of f(t) below it
+#define LAB_EPSILON 0.008856452f
+#define LAB_KAPPA 7.787037f
+#define LAB_OFFSET 0.13793103f
+#define LAB_DELTA 0.20689655f
+
+// linear sRGB -> XYZ with every row divided by the white point, so white maps to (1, 1, 1)
+static const float rgb_to_xyz[3][3] = {
+        {0.4124564 / WHITE_X, 0.3575761 / WHITE_X, 0.1804375 / WHITE_X},
+        {0.2126729 / WHITE_Y, 0.7151522 / WHITE_Y, 0.0721750 / WHITE_Y},
+        {0.0193339 / WHITE_Z, 0.1191920 / WHITE_Z, 0.9503041 / WHITE_Z}
+};
+
+static const float xyz_to_rgb[3][3] = {
+        {3.2404542 * WHITE_X, -1.5371385 * WHITE_Y, -0.4985314 * WHITE_Z},
+        {-0.9692660 * WHITE_X, 1.8760108 * WHITE_Y, 0.0415560 * WHITE_Z},
+        {0.0556434 * WHITE_X, -0.2040259 * WHITE_Y, 1.0572252 * WHITE_Z}
+};
+
+// the encoding thresholds are at least 1 / (255 * 12.92) apart, so each bucket holds one of them at most
+#define ENCODE_BUCKETS 4096
+
+static float srgb_to_linear[256];
+// srgb_thresholds[k] is the linear value where the encoded sample rounds up from k to k + 1
+static float srgb_thresholds[256];
+// number of thresholds below the start of each bucket
+static unsigned char srgb_buckets[ENCODE_BUCKETS + 1];
+static pthread_once_t tables_once = PTHREAD_ONCE_INIT;
+
+static double srgb_decode(double v) {
+    return v <= 0.04045 ? v / 12.92 : pow((v + 0.055) / 1.055, 2.4);
+}
+
+static void init_tables(void) {
+    for (int i = 0; i < 256; ++i) {
+        srgb_to_linear[i] = (float) srgb_decode(i / 255.);
+    }
+    for (int i = 0; i < 255; ++i) {
+        srgb_thresholds[i] = (float) srgb_decode((i + 0.5) / 255.);
+    }
+    srgb_thresholds[255] = INFINITY;
+
+    int k = 0;
+    for (int i = 0; i <= ENCODE_BUCKETS; ++i) {
+        while (srgb_thresholds[k] <= (float) i / ENCODE_BUCKETS) {
+            ++k;
+        }
+        srgb_buckets[i] = k;
+    }
+}
+
+// the bucket gives the encoding up to one threshold, checking it rounds exactly without pow
+static unsigned char linear_to_srgb(float v) {
+    v = v < 0.f ? 0.f : v > 1.f ? 1.f : v;
+    const int k = srgb_buckets[(int) (v * ENCODE_BUCKETS)];
+    return k + (v >= srgb_thresholds[k]);
+}
+
+static unsigned char to_byte(float v) {
+    v = v < 0.f ? 0.f : v > 255.f ? 255.f : v;
+    return (unsigned char) (v + 0.5f);
+}
+
+// bit-level initial guess (exponent divided by three) refined by two Newton steps, for x >= 0
+static float cube_root(float x) {
+    uint32_t bits;
+    memcpy(&bits, &x, sizeof(bits));
+    bits = bits / 3 + 0x2a5137a0u;
+    float y;
+    memcpy(&y, &bits, sizeof(y));
+    y = (2.f * y + x / (y * y)) * (1.f / 3.f);
+    y = (2.f * y + x / (y * y)) * (1.f / 3.f);
+    return y;
+}
+
+static float lab_f(float t) {
+    const float root = cube_root(t);
+    return t > LAB_EPSILON ? root : LAB_KAPPA * t + LAB_OFFSET;
+}
+
+static float lab_f_inverse(float f) {
+    return f > LAB_DELTA ? f * f * f : (f - LAB_OFFSET) * (1.f / LAB_KAPPA);
+}
+
+static void linear_to_xyz(unsigned char r, unsigned char g, unsigned char b, float *x, float *y, float *z) {
+    const float lr = srgb_to_linear[r];
+    const float lg = srgb_to_linear[g];
+    const float lb = srgb_to_linear[b];
+    *x = rgb_to_xyz[0][0] * lr + rgb_to_xyz[0][1] * lg + rgb_to_xyz[0][2] * lb;
+    *y = rgb_to_xyz[1][0] * lr + rgb_to_xyz[1][1] * lg + rgb_to_xyz[1][2] * lb;
+    *z = rgb_to_xyz[2][0] * lr + rgb_to_xyz[2][1] * lg + rgb_to_xyz[2][2] * lb;
+}
+
+static void xyz_to_srgb(float x, float y, float z, unsigned char *r, unsigned char *g, unsigned char *b) {
+    *r = linear_to_srgb(xyz_to_rgb[0][0] * x + xyz_to_rgb[0][1] * y + xyz_to_rgb[0][2] * z);
+    *g = linear_to_srgb(xyz_to_rgb[1][0] * x + xyz_to_rgb[1][1] * y + xyz_to_rgb[1][2] * z);
+    *b = linear_to_srgb(xyz_to_rgb[2][0] * x + xyz_to_rgb[2][1] * y + xyz_to_rgb[2][2] * z);
+}
+
+void XYZ_from_rgb_planes(unsigned char *restrict p1, unsigned char *restrict p2, unsigned char *restrict p3,
+                         size_t count) {
+    pthread_once(&tables_once, init_tables);
+    for (size_t i = 0; i < count; ++i) {
+        float x, y, z;
+        linear_to_xyz(p1[i], p2[i], p3[i], &x, &y, &z);
+        p1[i] = to_byte(255.f * x);
+        p2[i] = to_byte(255.f * y);
+        p3[i] = to_byte(255.f * z);
+    }
+}
+
+void XYZ_to_rgb_planes(unsigned char *restrict p1, unsigned char *restrict p2, unsigned char *restrict p3,
+                       size_t count) {
+    pthread_once(&tables_once, init_tables);
+    for (size_t i = 0; i < count; ++i) {
+        xyz_to_srgb(p1[i] * (1.f / 255.f), p2[i] * (1.f / 255.f), p3[i] * (1.f / 255.f), &p1[i], &p2[i], &p3[i]);
+    }
+}
+
+void Lab_from_rgb_planes(unsigned char *restrict p1, unsigned char *restrict p2, unsigned char *restrict p3,
+                         size_t count) {
+    pthread_once(&tables_once, init_tables);
+    for (size_t i = 0; i < count; ++i) {
+        float x, y, z;
+        linear_to_xyz(p1[i], p2[i], p3[i], &x, &y, &z);
+        const float fx = lab_f(x);
+        const float fy = lab_f(y);
+        const float fz = lab_f(z);
+        p1[i] = to_byte((116.f * fy - 16.f) * (255.f / 100.f));
+        p2[i] = to_byte(500.f * (fx - fy) + 128.f);
+        p3[i] = to_byte(200.f * (fy - fz) + 128.f);
+    }
+}
+
+void Lab_to_rgb_planes(unsigned char *restrict p1, unsigned char *restrict p2, unsigned char *restrict p3,
+                       size_t count) {
+    pthread_once(&tables_once, init_tables);
+    for (size_t i = 0; i < count; ++i) {
+        const float fy = (p1[i] * (100.f / 255.f) + 16.f) * (1.f / 116.f);
+        const float fx = fy + (p2[i] - 128.f) * (1.f / 500.f);
+        const float fz = fy - (p3[i] - 128.f) * (1.f / 200.f);
+        xyz_to_srgb(lab_f_inverse(fx), lab_f_inverse(fy), lab_f_inverse(fz), &p1[i], &p2[i], &p3[i]);
+    }
+}
+
+void XYZ_to_rgb_pixel(unsigned char *s1, unsigned char *s2, unsigned char *s3) {
+    XYZ_to_rgb_planes(s1, s2, s3, 1);
+}
+
+void XYZ_from_rgb_pixel(unsigned char *s1, unsigned char *s2, unsigned char *s3) {
+    XYZ_from_rgb_planes(s1, s2, s3, 1);
+}
+
+void Lab_to_rgb_pixel(unsigned char *s1, unsigned char *s2, unsigned char *s3) {
+    Lab_to_rgb_planes(s1, s2, s3, 1);
+}
+
+void Lab_from_rgb_pixel(unsigned char *s1, unsigned char *s2, unsigned char *s3) {
+    Lab_from_rgb_planes(s1, s2, s3, 1);
+}
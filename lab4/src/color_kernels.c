@@ -0,0 +1,284 @@
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../include/color_kernels.h"
+#include "../include/color_space.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define X86_KERNELS 1
+#include <immintrin.h>
+#endif
+
+void affine_planes_scalar(const affine_transform *t, unsigned char *p1, unsigned char *p2, unsigned char *p3,
+                          size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        affine_pixel(t, &p1[i], &p2[i], &p3[i]);
+    }
+}
+
+void deinterleave_rgb_scalar(const unsigned char *src, unsigned char *p1, unsigned char *p2, unsigned char *p3,
+                             size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        p1[i] = src[3 * i];
+        p2[i] = src[3 * i + 1];
+        p3[i] = src[3 * i + 2];
+    }
+}
+
+void interleave_rgb_scalar(const unsigned char *p1, const unsigned char *p2, const unsigned char *p3,
+                           unsigned char *dst, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        dst[3 * i] = p1[i];
+        dst[3 * i + 1] = p2[i];
+        dst[3 * i + 2] = p3[i];
+    }
+}
+
+#ifdef X86_KERNELS
+
+/*
+ * Vector kernels evaluate every channel exactly like affine_pixel(): (m0 * s1 + m1 * s2) + m2 * s3 + m3
+ * in single precision without fma, then clamp and round half away from zero, so they are bit-exact
+ * with the scalar functions.
+ */
+
+__attribute__((target("sse2")))
+static inline __m128i round_clamped_sse2(__m128 v) {
+    v = _mm_min_ps(_mm_max_ps(v, _mm_setzero_ps()), _mm_set1_ps(255.f));
+    const __m128 whole = _mm_cvtepi32_ps(_mm_cvttps_epi32(v));
+    const __m128 up = _mm_and_ps(_mm_cmpge_ps(_mm_sub_ps(v, whole), _mm_set1_ps(0.5f)), _mm_set1_ps(1.f));
+    return _mm_cvttps_epi32(_mm_add_ps(whole, up));
+}
+
+__attribute__((target("sse2")))
+static inline __m128i affine_channel_sse2(const float *row, __m128 a, __m128 b, __m128 c) {
+    __m128 v = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(row[0]), a), _mm_mul_ps(_mm_set1_ps(row[1]), b));
+    v = _mm_add_ps(v, _mm_mul_ps(_mm_set1_ps(row[2]), c));
+    v = _mm_add_ps(v, _mm_set1_ps(row[3]));
+    return round_clamped_sse2(v);
+}
+
+__attribute__((target("sse2")))
+static inline void widen_sse2(__m128i bytes, __m128 out[4]) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i lo = _mm_unpacklo_epi8(bytes, zero);
+    const __m128i hi = _mm_unpackhi_epi8(bytes, zero);
+    out[0] = _mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero));
+    out[1] = _mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero));
+    out[2] = _mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero));
+    out[3] = _mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero));
+}
+
+__attribute__((target("sse2")))
+void affine_planes_sse2(const affine_transform *t, unsigned char *p1, unsigned char *p2, unsigned char *p3,
+                        size_t count) {
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m128 a[4];
+        __m128 b[4];
+        __m128 c[4];
+        widen_sse2(_mm_loadu_si128((const __m128i *) (p1 + i)), a);
+        widen_sse2(_mm_loadu_si128((const __m128i *) (p2 + i)), b);
+        widen_sse2(_mm_loadu_si128((const __m128i *) (p3 + i)), c);
+
+        unsigned char *const outs[3] = {p1 + i, p2 + i, p3 + i};
+        for (int k = 0; k < 3; ++k) {
+            const __m128i q0 = affine_channel_sse2(t->m[k], a[0], b[0], c[0]);
+            const __m128i q1 = affine_channel_sse2(t->m[k], a[1], b[1], c[1]);
+            const __m128i q2 = affine_channel_sse2(t->m[k], a[2], b[2], c[2]);
+            const __m128i q3 = affine_channel_sse2(t->m[k], a[3], b[3], c[3]);
+            const __m128i packed = _mm_packus_epi16(_mm_packs_epi32(q0, q1), _mm_packs_epi32(q2, q3));
+            _mm_storeu_si128((__m128i *) outs[k], packed);
+        }
+    }
+    affine_planes_scalar(t, p1 + i, p2 + i, p3 + i, count - i);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i round_clamped_avx2(__m256 v) {
+    v = _mm256_min_ps(_mm256_max_ps(v, _mm256_setzero_ps()), _mm256_set1_ps(255.f));
+    const __m256 whole = _mm256_cvtepi32_ps(_mm256_cvttps_epi32(v));
+    const __m256 up = _mm256_and_ps(_mm256_cmp_ps(_mm256_sub_ps(v, whole), _mm256_set1_ps(0.5f), _CMP_GE_OQ),
+                                    _mm256_set1_ps(1.f));
+    return _mm256_cvttps_epi32(_mm256_add_ps(whole, up));
+}
+
+__attribute__((target("avx2")))
+static inline __m256i affine_channel_avx2(const float *row, __m256 a, __m256 b, __m256 c) {
+    __m256 v = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(row[0]), a), _mm256_mul_ps(_mm256_set1_ps(row[1]), b));
+    v = _mm256_add_ps(v, _mm256_mul_ps(_mm256_set1_ps(row[2]), c));
+    v = _mm256_add_ps(v, _mm256_set1_ps(row[3]));
+    return round_clamped_avx2(v);
+}
+
+__attribute__((target("avx2")))
+static inline void widen_avx2(const unsigned char *p, __m256 out[4]) {
+    const __m128i lo = _mm_loadu_si128((const __m128i *) p);
+    const __m128i hi = _mm_loadu_si128((const __m128i *) (p + 16));
+    out[0] = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(lo));
+    out[1] = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_srli_si128(lo, 8)));
+    out[2] = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(hi));
+    out[3] = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_srli_si128(hi, 8)));
+}
+
+__attribute__((target("avx2")))
+void affine_planes_avx2(const affine_transform *t, unsigned char *p1, unsigned char *p2, unsigned char *p3,
+                        size_t count) {
+    // packs work per 128-bit lane, this restores the original dword order afterwards
+    const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+    size_t i = 0;
+    for (; i + 32 <= count; i += 32) {
+        __m256 a[4];
+        __m256 b[4];
+        __m256 c[4];
+        widen_avx2(p1 + i, a);
+        widen_avx2(p2 + i, b);
+        widen_avx2(p3 + i, c);
+
+        unsigned char *const outs[3] = {p1 + i, p2 + i, p3 + i};
+        for (int k = 0; k < 3; ++k) {
+            const __m256i q0 = affine_channel_avx2(t->m[k], a[0], b[0], c[0]);
+            const __m256i q1 = affine_channel_avx2(t->m[k], a[1], b[1], c[1]);
+            const __m256i q2 = affine_channel_avx2(t->m[k], a[2], b[2], c[2]);
+            const __m256i q3 = affine_channel_avx2(t->m[k], a[3], b[3], c[3]);
+            const __m256i packed = _mm256_packus_epi16(_mm256_packs_epi32(q0, q1), _mm256_packs_epi32(q2, q3));
+            _mm256_storeu_si256((__m256i *) outs[k], _mm256_permutevar8x32_epi32(packed, order));
+        }
+    }
+    affine_planes_sse2(t, p1 + i, p2 + i, p3 + i, count - i);
+}
+
+// pshufb masks for 16 pixels = 48 bytes: [plane][source vector] and [destination vector][plane]
+static const signed char deinterleave_masks[3][3][16] = {
+        {{0, 3, 6, 9, 12, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+                {-1, -1, -1, -1, -1, -1, 2, 5, 8, 11, 14, -1, -1, -1, -1, -1},
+                {-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 1, 4, 7, 10, 13}},
+        {{1, 4, 7, 10, 13, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+                {-1, -1, -1, -1, -1, 0, 3, 6, 9, 12, 15, -1, -1, -1, -1, -1},
+                {-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 2, 5, 8, 11, 14}},
+        {{2, 5, 8, 11, 14, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+                {-1, -1, -1, -1, -1, 1, 4, 7, 10, 13, -1, -1, -1, -1, -1, -1},
+                {-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 0, 3, 6, 9, 12, 15}}
+};
+
+static const signed char interleave_masks[3][3][16] = {
+        {{0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1, -1, 5},
+                {-1, 0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1, -1},
+                {-1, -1, 0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1}},
+        {{-1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1, 10, -1},
+                {5, -1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1, 10},
+                {-1, 5, -1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1}},
+        {{-1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15, -1, -1},
+                {-1, -1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15, -1},
+                {10, -1, -1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15}}
+};
+
+__attribute__((target("ssse3")))
+static inline __m128i shuffle3_ssse3(const signed char masks[3][16], __m128i a, __m128i b, __m128i c) {
+    const __m128i ma = _mm_shuffle_epi8(a, _mm_loadu_si128((const __m128i *) masks[0]));
+    const __m128i mb = _mm_shuffle_epi8(b, _mm_loadu_si128((const __m128i *) masks[1]));
+    const __m128i mc = _mm_shuffle_epi8(c, _mm_loadu_si128((const __m128i *) masks[2]));
+    return _mm_or_si128(_mm_or_si128(ma, mb), mc);
+}
+
+__attribute__((target("ssse3")))
+void deinterleave_rgb_ssse3(const unsigned char *src, unsigned char *p1, unsigned char *p2, unsigned char *p3,
+                            size_t count) {
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        const __m128i a = _mm_loadu_si128((const __m128i *) (src + 3 * i));
+        const __m128i b = _mm_loadu_si128((const __m128i *) (src + 3 * i + 16));
+        const __m128i c = _mm_loadu_si128((const __m128i *) (src + 3 * i + 32));
+        _mm_storeu_si128((__m128i *) (p1 + i), shuffle3_ssse3(deinterleave_masks[0], a, b, c));
+        _mm_storeu_si128((__m128i *) (p2 + i), shuffle3_ssse3(deinterleave_masks[1], a, b, c));
+        _mm_storeu_si128((__m128i *) (p3 + i), shuffle3_ssse3(deinterleave_masks[2], a, b, c));
+    }
+    deinterleave_rgb_scalar(src + 3 * i, p1 + i, p2 + i, p3 + i, count - i);
+}
+
+__attribute__((target("ssse3")))
+void interleave_rgb_ssse3(const unsigned char *p1, const unsigned char *p2, const unsigned char *p3,
+                          unsigned char *dst, size_t count) {
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        const __m128i a = _mm_loadu_si128((const __m128i *) (p1 + i));
+        const __m128i b = _mm_loadu_si128((const __m128i *) (p2 + i));
+        const __m128i c = _mm_loadu_si128((const __m128i *) (p3 + i));
+        _mm_storeu_si128((__m128i *) (dst + 3 * i), shuffle3_ssse3(interleave_masks[0], a, b, c));
+        _mm_storeu_si128((__m128i *) (dst + 3 * i + 16), shuffle3_ssse3(interleave_masks[1], a, b, c));
+        _mm_storeu_si128((__m128i *) (dst + 3 * i + 32), shuffle3_ssse3(interleave_masks[2], a, b, c));
+    }
+    interleave_rgb_scalar(p1 + i, p2 + i, p3 + i, dst + 3 * i, count - i);
+}
+
+void deinterleave_rgb(const unsigned char *src, unsigned char *p1, unsigned char *p2, unsigned char *p3,
+                      size_t count) {
+    if (__builtin_cpu_supports("ssse3")) {
+        deinterleave_rgb_ssse3(src, p1, p2, p3, count);
+    } else {
+        deinterleave_rgb_scalar(src, p1, p2, p3, count);
+    }
+}
+
+void interleave_rgb(const unsigned char *p1, const unsigned char *p2, const unsigned char *p3, unsigned char *dst,
+                    size_t count) {
+    if (__builtin_cpu_supports("ssse3")) {
+        interleave_rgb_ssse3(p1, p2, p3, dst, count);
+    } else {
+        interleave_rgb_scalar(p1, p2, p3, dst, count);
+    }
+}
+
+affine_planes_func affine_planes_kernel(void) {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return affine_planes_avx2;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return affine_planes_sse2;
+    }
+    return affine_planes_scalar;
+}
+
+#else
+
+void affine_planes_sse2(const affine_transform *t, unsigned char *p1, unsigned char *p2, unsigned char *p3,
+                        size_t count) {
+    affine_planes_scalar(t, p1, p2, p3, count);
+}
+
+void affine_planes_avx2(const affine_transform *t, unsigned char *p1, unsigned char *p2, unsigned char *p3,
+                        size_t count) {
+    affine_planes_scalar(t, p1, p2, p3, count);
+}
+
+affine_planes_func affine_planes_kernel(void) {
+    return affine_planes_scalar;
+}
+
+void deinterleave_rgb_ssse3(const unsigned char *src, unsigned char *p1, unsigned char *p2, unsigned char *p3,
+                            size_t count) {
+    deinterleave_rgb_scalar(src, p1, p2, p3, count);
+}
+
+void interleave_rgb_ssse3(const unsigned char *p1, const unsigned char *p2, const unsigned char *p3,
+                          unsigned char *dst, size_t count) {
+    interleave_rgb_scalar(p1, p2, p3, dst, count);
+}
+
+void deinterleave_rgb(const unsigned char *src, unsigned char *p1, unsigned char *p2, unsigned char *p3,
+                      size_t count) {
+    deinterleave_rgb_scalar(src, p1, p2, p3, count);
+}
+
+void interleave_rgb(const unsigned char *p1, const unsigned char *p2, const unsigned char *p3, unsigned char *dst,
+                    size_t count) {
+    interleave_rgb_scalar(p1, p2, p3, dst, count);
+}
+
+#endif
+
+void affine_planes(const affine_transform *t, unsigned char *p1, unsigned char *p2, unsigned char *p3,
+                   size_t count) {
+    affine_planes_kernel()(t, p1, p2, p3, count);
+}
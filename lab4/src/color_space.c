@@ -8,6 +8,120 @@
 #include "../include/picture.h"
 #include "../include/utility.h"
 
+static const affine_transform identity = {.m = {
+        {1.f, 0.f, 0.f, 0.f},
+        {0.f, 1.f, 0.f, 0.f},
+        {0.f, 0.f, 1.f, 0.f}
+}};
+
+static const affine_transform YCbCr_601_to_rgb = {.m = {
+        {1.f, 0.f, 1.402f, -1.402f * 128.f},
+        {1.f, -0.344136f, -0.714136f, (0.344136f + 0.714136f) * 128.f},
+        {1.f, 1.772f, 0.f, -1.772f * 128.f}
+}};
+
+static const affine_transform YCbCr_709_to_rgb = {.m = {
+        {1.f, 0.f, 1.5748f, -1.5748f * 128.f},
+        {1.f, -0.18732427f, -0.46812427f, (0.18732427f + 0.46812427f) * 128.f},
+        {1.f, 1.8556f, 0.f, -1.8556f * 128.f}
+}};
+
+static const affine_transform YCoCg_to_rgb = {.m = {
+        {1.f, 1.f, -1.f, 0.f},
+        {1.f, 0.f, 1.f, -128.f},
+        {1.f, -1.f, -1.f, 256.f}
+}};
+
+static const affine_transform CMY_to_rgb = {.m = {
+        {-1.f, 0.f, 0.f, 255.f},
+        {0.f, -1.f, 0.f, 255.f},
+        {0.f, 0.f, -1.f, 255.f}
+}};
+
+static const affine_transform YCbCr_601_from_rgb = {.m = {
+        {0.299f, 0.587f, 0.114f, 0.f},
+        {-0.168736f, -0.331264f, 0.5f, 128.f},
+        {0.5f, -0.418688f, -0.081312f, 128.f}
+}};
+
+static const affine_transform YCbCr_709_from_rgb = {.m = {
+        {0.2126f, 0.7152f, 0.0722f, 0.f},
+        {-0.11457211f, -0.38542789f, 0.5f, 128.f},
+        {0.5f, -0.45415291f, -0.04584709f, 128.f}
+}};
+
+static const affine_transform YCoCg_from_rgb = {.m = {
+        {0.25f, 0.5f, 0.25f, 0.f},
+        {0.5f, 0.f, -0.5f, 128.f},
+        {-0.25f, 0.5f, -0.25f, 128.f}
+}};
+
+static unsigned char affine_channel(const float *row, float s1, float s2, float s3) {
+    float v = row[0] * s1 + row[1] * s2;
+    v += row[2] * s3;
+    v += row[3];
+    return roundf(fminf(fmaxf(v, 0.f), 255.f));
+}
+
+void affine_pixel(const affine_transform *t, unsigned char *s1, unsigned char *s2, unsigned char *s3) {
+    const float a = *s1;
+    const float b = *s2;
+    const float c = *s3;
+
+    *s1 = affine_channel(t->m[0], a, b, c);
+    *s2 = affine_channel(t->m[1], a, b, c);
+    *s3 = affine_channel(t->m[2], a, b, c);
+}
+
+const affine_transform *to_rgb_affine(color_space space) {
+    switch (space) {
+        case RGB:
+            return &identity;
+        case YCbCr_601:
+            return &YCbCr_601_to_rgb;
+        case YCbCr_709:
+            return &YCbCr_709_to_rgb;
+        case YCoCg:
+            return &YCoCg_to_rgb;
+        case CMY:
+            return &CMY_to_rgb;
+        default:
+            return NULL;
+    }
+}
+
+const affine_transform *from_rgb_affine(color_space space) {
+    switch (space) {
+        case RGB:
+            return &identity;
+        case YCbCr_601:
+            return &YCbCr_601_from_rgb;
+        case YCbCr_709:
+            return &YCbCr_709_from_rgb;
+        case YCoCg:
+            return &YCoCg_from_rgb;
+        case CMY:
+            return &CMY_to_rgb;
+        default:
+            return NULL;
+    }
+}
+
+// out = outer(inner(x)), accumulated in double so the composed table carries a single float rounding
+void affine_compose(const affine_transform *outer, const affine_transform *inner, affine_transform *out) {
+    affine_transform result;
+    for (int i = 0; i < 3; ++i) {
+        for (int j = 0; j < 4; ++j) {
+            double v = j == 3 ? outer->m[i][3] : 0.;
+            for (int k = 0; k < 3; ++k) {
+                v += (double) outer->m[i][k] * inner->m[k][j];
+            }
+            result.m[i][j] = (float) v;
+        }
+    }
+    *out = result;
+}
+
 static float hue_to_rgb(float p, float q, float t) {
     if (t < 0) t += 1;
     if (t > 1) t -= 1;
@@ -69,31 +183,11 @@ void hsv_to_rgb_pixel(unsigned char *s1, unsigned char *s2, unsigned char *s3) {
 }
 
 void YCbCr_601_to_rgb_pixel(unsigned char *s1, unsigned char *s2, unsigned char *s3) {
-    const float y = *s1;
-    const float cb = *s2;
-    const float cr = *s3;
-
-    const float r = y + 1.5748f * (cr - 128.f);
-    const float g = y - 0.18732427f * (cb - 128.f) - 0.46812427f * (cr - 128.f);
-    const float b = y + 1.8556f * (cb - 128.f);
-
-    *s1 = roundf(fminf(fmaxf(r, 0.f), 255.f));
-    *s2 = roundf(fminf(fmaxf(g, 0.f), 255.f));
-    *s3 = roundf(fminf(fmaxf(b, 0.f), 255.f));
+    affine_pixel(&YCbCr_601_to_rgb, s1, s2, s3);
 }
 
 void YCbCr_709_to_rgb_pixel(unsigned char *s1, unsigned char *s2, unsigned char *s3) {
-    const float y = *s1;
-    const float cb = *s2;
-    const float cr = *s3;
-
-    const float r = y + 1.402f * (cr - 128.f);
-    const float g = y - 0.344136f * (cb - 128.f) - 0.714136 * (cr - 128.f);
-    const float b = y + 1.772 * (cb - 128.f);
-
-    *s1 = roundf(fminf(fmaxf(r, 0.f), 255.f));
-    *s2 = roundf(fminf(fmaxf(g, 0.f), 255.f));
-    *s3 = roundf(fminf(fmaxf(b, 0.f), 255.f));
+    affine_pixel(&YCbCr_709_to_rgb, s1, s2, s3);
 }
 
 static void to_rgb(color_sources sources, to_rgb_pixel_func func) {
@@ -184,87 +278,27 @@ void hsv_from_rgb_pixel(unsigned char *s1, unsigned char *s2, unsigned char *s3)
 }
 
 void YCbCr_601_from_rgb_pixel(unsigned char *s1, unsigned char *s2, unsigned char *s3) {
-    double r = *s1;
-    double g = *s2;
-    double b = *s3;
-
-    double y = 0.299 * r + 0.587 * g + 0.114 * b;
-    double cb = -0.168736 * r - 0.331264 * g + 0.5 * b + 128.0;
-    double cr = 0.5 * r - 0.418688 * g - 0.081312 * b + 128.0;
-
-    *s1 = round(fminf(fmaxf(y, 0.f), 255.f));
-    *s2 = round(fminf(fmaxf(cb, 0.f), 255.f));
-    *s3 = round(fminf(fmaxf(cr, 0.f), 255.f));
+    affine_pixel(&YCbCr_601_from_rgb, s1, s2, s3);
 }
 
 void YCbCr_709_from_rgb_pixel(unsigned char *s1, unsigned char *s2, unsigned char *s3) {
-    const float r = *s1;
-    const float g = *s2;
-    const float b = *s3;
-
-    const float y = 0.2126f * r + 0.7152f * g + 0.0722f * b;
-    const float cb = -0.11457211f * r - 0.38542789f * g + 0.5f * b + 128.f;
-    const float cr = 0.5f * r - 0.45415291f * g - 0.04584709f * b + 128.f;
-
-    *s1 = round(fminf(fmaxf(y, 0.f), 255.f));
-    *s2 = round(fminf(fmaxf(cb, 0.f), 255.f));
-    *s3 = round(fminf(fmaxf(cr, 0.f), 255.f));
+    affine_pixel(&YCbCr_709_from_rgb, s1, s2, s3);
 }
 
 void YCoCg_to_rgb_pixel(unsigned char *s1, unsigned char *s2, unsigned char *s3) {
-    const float y = *s1;
-    const float co = *s2 - 128.f;
-    const float cg = *s3 - 128.f;
-
-    const float r = y + co - cg;
-    const float g = y + cg;
-    const float b = y - co - cg;
-
-    *s1 = round(fminf(fmaxf(r, 0.f), 255.f));
-    *s2 = round(fminf(fmaxf(g, 0.f), 255.f));
-    *s3 = round(fminf(fmaxf(b, 0.f), 255.f));
+    affine_pixel(&YCoCg_to_rgb, s1, s2, s3);
 }
 
 void YCoCg_from_rgb_pixel(unsigned char *s1, unsigned char *s2, unsigned char *s3) {
-    const float r = *s1;
-    const float g = *s2;
-    const float b = *s3;
-
-    const float y = 0.25f * r + 0.5f * g + 0.25f * b;
-    const float co = 0.5f * r - 0.5f * b + 128.f;
-    const float cg = -0.25f * r + 0.5f * g - 0.25f * b + 128.f;
-
-    *s1 = round(fminf(fmaxf(y, 0.f), 255.f));
-    *s2 = round(fminf(fmaxf(co, 0.f), 255.f));
-    *s3 = round(fminf(fmaxf(cg, 0.f), 255.f));
+    affine_pixel(&YCoCg_from_rgb, s1, s2, s3);
 }
 
 void CMY_to_rgb_pixel(unsigned char *s1, unsigned char *s2, unsigned char *s3) {
-    const float c = *s1 / 255.f;
-    const float m = *s2 / 255.f;
-    const float y = *s3 / 255.f;
-
-    const float r = 255.f * (1.f - c);
-    const float g = 255.f * (1.f - m);
-    const float b = 255.f * (1.f - y);
-
-    *s1 = round(fminf(fmaxf(r, 0.f), 255.f));
-    *s2 = round(fminf(fmaxf(g, 0.f), 255.f));
-    *s3 = round(fminf(fmaxf(b, 0.f), 255.f));
+    affine_pixel(&CMY_to_rgb, s1, s2, s3);
 }
 
 void CMY_from_rgb_pixel(unsigned char *s1, unsigned char *s2, unsigned char *s3) {
-    const float r = *s1 / 255.f;
-    const float g = *s2 / 255.f;
-    const float b = *s3 / 255.f;
-
-    const float c = 255.f * (1.f - r);
-    const float m = 255.f * (1.f - g);
-    const float y = 255.f * (1.f - b);
-
-    *s1 = round(fminf(fmaxf(c, 0.f), 255.f));
-    *s2 = round(fminf(fmaxf(m, 0.f), 255.f));
-    *s3 = round(fminf(fmaxf(y, 0.f), 255.f));
+    affine_pixel(&CMY_to_rgb, s1, s2, s3);
 }
 
 void from_rgb(color_sources sources, from_rgb_pixel_func func) {
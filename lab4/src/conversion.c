@@ -0,0 +1,236 @@
+#include <stdio.h>
+#include <stdbool.h>
+
+#include "../include/conversion.h"
+#include "../include/color_space.h"
+#include "../include/color_kernels.h"
+#include "../include/ycc_fixed.h"
+#include "../include/lut3d.h"
+#include "../include/cie.h"
+#include "../include/thread_pool.h"
+#include "../include/defines.h"
+
+#define INTERLEAVED_BLOCK 4096
+#define PARALLEL_GRAIN_PIXELS 65536
+
+const char *const color_space_names[] = {
+        [RGB] = "RGB",
+        [HSL] = "HSL",
+        [HSV] = "HSV",
+        [YCbCr_601] = "YCbCr_601",
+        [YCbCr_709] = "YCbCr_709",
+        [YCoCg] = "YCoCg",
+        [CMY] = "CMY",
+        [YCoCg_R] = "YCoCg_R",
+        [XYZ] = "XYZ",
+        [Lab] = "Lab"
+};
+
+const to_rgb_pixel_func to_rgb_funcs[] = {
+        [RGB] = noop,
+        [HSL] = hsl_to_rgb_pixel,
+        [HSV] = hsv_to_rgb_pixel,
+        [YCbCr_601] = YCbCr_601_to_rgb_pixel,
+        [YCbCr_709] = YCbCr_709_to_rgb_pixel,
+        [YCoCg] = YCoCg_to_rgb_pixel,
+        [CMY] = CMY_to_rgb_pixel,
+        [XYZ] = XYZ_to_rgb_pixel,
+        [Lab] = Lab_to_rgb_pixel
+};
+
+const from_rgb_pixel_func from_rgb_funcs[] = {
+        [RGB] = noop,
+        [HSL] = hsl_from_rgb_pixel,
+        [HSV] = hsv_from_rgb_pixel,
+        [YCbCr_601] = YCbCr_601_from_rgb_pixel,
+        [YCbCr_709] = YCbCr_709_from_rgb_pixel,
+        [YCoCg] = YCoCg_from_rgb_pixel,
+        [CMY] = CMY_from_rgb_pixel,
+        [XYZ] = XYZ_from_rgb_pixel,
+        [Lab] = Lab_from_rgb_pixel
+};
+
+int prepare_lut(lut3d *lut, int size, color_space from, color_space to, const char *cache_dir) {
+    filename cache;
+    // the version in the name keeps tables baked by older code from being picked up
+    const bool cached = size == LUT3D_EXACT && cache_dir != NULL &&
+                        snprintf(cache.data, sizeof(cache.data), "%s/lut3d_v%d_%s_%s.bin", cache_dir, LUT3D_VERSION,
+                                 color_space_names[from], color_space_names[to]) < (int) sizeof(cache.data);
+
+    if (cached && lut3d_load(lut, cache.data) == SUCCESS) {
+        if (lut->size == size)
+            return SUCCESS;
+        lut3d_free(lut);
+    }
+
+    int ret;
+    if ((ret = lut3d_bake(lut, size, to_rgb_funcs[from], from_rgb_funcs[to])) != SUCCESS)
+        return ret;
+
+    if (cached && lut3d_save(lut, cache.data) != SUCCESS)
+        fprintf(stderr, "can't write lut cache %s.\n", cache.data);
+    return SUCCESS;
+}
+
+void conversion_init(conversion *conv, color_space from, color_space to, arithmetic arithmetic, const lut3d *lut) {
+    conv->from = from;
+    conv->to = to;
+    conv->lut = lut;
+    conv->affine_kernel = affine_planes_kernel();
+
+    if (from == to) {
+        conv->kind = CONVERT_COPY;
+        return;
+    }
+
+    if (lut != NULL) {
+        conv->kind = CONVERT_LUT;
+        return;
+    }
+
+    if (arithmetic == FIXED_POINT) {
+        if (from == RGB && ycc_tables_for(to, &conv->ycc) == SUCCESS) {
+            conv->kind = CONVERT_YCC_FROM_RGB;
+            return;
+        }
+        if (to == RGB && ycc_tables_for(from, &conv->ycc) == SUCCESS) {
+            conv->kind = CONVERT_YCC_TO_RGB;
+            return;
+        }
+    }
+
+    const affine_transform *inner = to_rgb_affine(from);
+    const affine_transform *outer = from_rgb_affine(to);
+    if (inner == NULL || outer == NULL) {
+        conv->kind = CONVERT_TWO_STAGE;
+        return;
+    }
+
+    conv->kind = CONVERT_AFFINE;
+    affine_compose(outer, inner, &conv->affine);
+}
+
+typedef void (*planes_func)(unsigned char *p1, unsigned char *p2, unsigned char *p3, size_t count);
+
+static planes_func to_rgb_planes(color_space space) {
+    switch (space) {
+        case XYZ:
+            return XYZ_to_rgb_planes;
+        case Lab:
+            return Lab_to_rgb_planes;
+        default:
+            return NULL;
+    }
+}
+
+static planes_func from_rgb_planes(color_space space) {
+    switch (space) {
+        case XYZ:
+            return XYZ_from_rgb_planes;
+        case Lab:
+            return Lab_from_rgb_planes;
+        default:
+            return NULL;
+    }
+}
+
+static void apply_stage(const conversion *conv, const affine_transform *affine, planes_func planes,
+                        to_rgb_pixel_func func, unsigned char *p1, unsigned char *p2, unsigned char *p3,
+                        size_t count) {
+    if (affine != NULL) {
+        conv->affine_kernel(affine, p1, p2, p3, count);
+        return;
+    }
+
+    if (planes != NULL) {
+        planes(p1, p2, p3, count);
+        return;
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        func(&p1[i], &p2[i], &p3[i]);
+    }
+}
+
+void conversion_apply(const conversion *conv, unsigned char *p1, unsigned char *p2, unsigned char *p3,
+                      size_t count) {
+    switch (conv->kind) {
+        case CONVERT_COPY:
+            break;
+        case CONVERT_LUT:
+            lut3d_apply_planes(conv->lut, p1, p2, p3, count);
+            break;
+        case CONVERT_YCC_FROM_RGB:
+            ycc_from_rgb_planes(&conv->ycc, p1, p2, p3, count);
+            break;
+        case CONVERT_YCC_TO_RGB:
+            ycc_to_rgb_planes(&conv->ycc, p1, p2, p3, count);
+            break;
+        case CONVERT_AFFINE:
+            conv->affine_kernel(&conv->affine, p1, p2, p3, count);
+            break;
+        case CONVERT_TWO_STAGE:
+            if (conv->from != RGB)
+                apply_stage(conv, to_rgb_affine(conv->from), to_rgb_planes(conv->from), to_rgb_funcs[conv->from],
+                            p1, p2, p3, count);
+            if (conv->to != RGB)
+                apply_stage(conv, from_rgb_affine(conv->to), from_rgb_planes(conv->to), from_rgb_funcs[conv->to],
+                            p1, p2, p3, count);
+            break;
+    }
+}
+
+void conversion_apply_interleaved(const conversion *conv, unsigned char *pixels, size_t count) {
+    if (conv->kind == CONVERT_COPY)
+        return;
+
+    unsigned char p1[INTERLEAVED_BLOCK];
+    unsigned char p2[INTERLEAVED_BLOCK];
+    unsigned char p3[INTERLEAVED_BLOCK];
+    for (size_t i = 0; i < count; i += INTERLEAVED_BLOCK) {
+        const size_t n = count - i < INTERLEAVED_BLOCK ? count - i : INTERLEAVED_BLOCK;
+        unsigned char *block = pixels + 3 * i;
+        deinterleave_rgb(block, p1, p2, p3, n);
+        conversion_apply(conv, p1, p2, p3, n);
+        interleave_rgb(p1, p2, p3, block, n);
+    }
+}
+
+typedef struct {
+    const conversion *conv;
+    unsigned char *planes[3];
+    unsigned char *pixels;
+    size_t width;
+} rows_job;
+
+static void planes_rows(void *context, size_t begin, size_t end) {
+    const rows_job *job = context;
+    const size_t offset = begin * job->width;
+    conversion_apply(job->conv, job->planes[0] + offset, job->planes[1] + offset, job->planes[2] + offset,
+                     (end - begin) * job->width);
+}
+
+static void interleaved_rows(void *context, size_t begin, size_t end) {
+    const rows_job *job = context;
+    conversion_apply_interleaved(job->conv, job->pixels + 3 * begin * job->width, (end - begin) * job->width);
+}
+
+static size_t rows_grain(size_t width) {
+    return width >= PARALLEL_GRAIN_PIXELS ? 1 : PARALLEL_GRAIN_PIXELS / width;
+}
+
+void conversion_apply_rows(thread_pool *pool, const conversion *conv, unsigned char *p1, unsigned char *p2,
+                           unsigned char *p3, size_t width, size_t height) {
+    if (conv->kind == CONVERT_COPY || width == 0)
+        return;
+    rows_job job = {.conv = conv, .planes = {p1, p2, p3}, .width = width};
+    parallel_for(pool, height, rows_grain(width), planes_rows, &job);
+}
+
+void conversion_apply_interleaved_rows(thread_pool *pool, const conversion *conv, unsigned char *pixels,
+                                       size_t width, size_t height) {
+    if (conv->kind == CONVERT_COPY || width == 0)
+        return;
+    rows_job job = {.conv = conv, .pixels = pixels, .width = width};
+    parallel_for(pool, height, rows_grain(width), interleaved_rows, &job);
+}
@@ -0,0 +1,230 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "../include/lut3d.h"
+#include "../include/color_space.h"
+#include "../include/defines.h"
+
+#define LUT3D_MAGIC "LUT3"
+#define LUT3D_HEADER_BYTES 8
+
+/*
+ * Grid node k of an n point table samples input k * 255 / (n - 1) rounded to the nearest integer, so the
+ * first and the last nodes are exactly 0 and 255 and every input on a node maps to its baked value.
+ * Cells are 15 or 16 inputs wide, the position inside one comes from a table.
+ */
+
+int lut3d_valid_size(int size) {
+    return size == 17 || size == 33 || size == 65 || size == LUT3D_EXACT;
+}
+
+static size_t lut3d_bytes(int size) {
+    return (size_t) size * size * size * 3;
+}
+
+static unsigned char node_value(int node, int size) {
+    return (node * 255 + (size - 1) / 2) / (size - 1);
+}
+
+static void lut3d_init_axis(lut3d *lut) {
+    if (lut->size == LUT3D_EXACT)
+        return;
+
+    int node = 0;
+    for (int v = 0; v < 256; ++v) {
+        while (node + 2 < lut->size && node_value(node + 1, lut->size) <= v) {
+            ++node;
+        }
+        const int low = node_value(node, lut->size);
+        const int width = node_value(node + 1, lut->size) - low;
+        lut->cell[v] = node;
+        lut->weight[v] = ((v - low) * LUT3D_WEIGHT_ONE + width / 2) / width;
+    }
+}
+
+int lut3d_bake(lut3d *lut, int size, to_rgb_pixel_func to, from_rgb_pixel_func from) {
+    if (!lut3d_valid_size(size)) {
+        return LOGIC_ERROR;
+    }
+
+    lut->size = size;
+    lut3d_init_axis(lut);
+    lut->data = malloc(lut3d_bytes(size));
+    if (lut->data == NULL) {
+        return NOMEM;
+    }
+
+    unsigned char *out = lut->data;
+    for (int a = 0; a < size; ++a) {
+        for (int b = 0; b < size; ++b) {
+            for (int c = 0; c < size; ++c) {
+                unsigned char s1 = node_value(a, size);
+                unsigned char s2 = node_value(b, size);
+                unsigned char s3 = node_value(c, size);
+                to(&s1, &s2, &s3);
+                from(&s1, &s2, &s3);
+                out[0] = s1;
+                out[1] = s2;
+                out[2] = s3;
+                out += 3;
+            }
+        }
+    }
+
+    return SUCCESS;
+}
+
+// the header is the magic, then the version and the grid size as little-endian 16-bit numbers
+static void write_u16(unsigned char *out, int value) {
+    out[0] = value & 255;
+    out[1] = (value >> 8) & 255;
+}
+
+static int read_u16(const unsigned char *in) {
+    return in[0] | in[1] << 8;
+}
+
+int lut3d_load(lut3d *lut, const char *path) {
+    FILE *in = fopen(path, "rb");
+    if (in == NULL) {
+        return FILE_ERROR;
+    }
+
+    unsigned char header[LUT3D_HEADER_BYTES];
+    const size_t magic = sizeof(LUT3D_MAGIC) - 1;
+    if (fread(header, 1, sizeof(header), in) != sizeof(header) ||
+        memcmp(header, LUT3D_MAGIC, magic) != 0 ||
+        read_u16(header + magic) != LUT3D_VERSION || !lut3d_valid_size(read_u16(header + magic + 2))) {
+        fclose(in);
+        return PARSE_ERROR;
+    }
+
+    const int size = read_u16(header + magic + 2);
+    const size_t bytes = lut3d_bytes(size);
+    unsigned char *data = malloc(bytes);
+    if (data == NULL) {
+        fclose(in);
+        return NOMEM;
+    }
+    if (fread(data, 1, bytes, in) != bytes) {
+        free(data);
+        fclose(in);
+        return PARSE_ERROR;
+    }
+    fclose(in);
+
+    lut->size = size;
+    lut3d_init_axis(lut);
+    lut->data = data;
+    return SUCCESS;
+}
+
+int lut3d_save(const lut3d *lut, const char *path) {
+    FILE *out = fopen(path, "wb");
+    if (out == NULL) {
+        return FILE_ERROR;
+    }
+
+    unsigned char header[LUT3D_HEADER_BYTES];
+    const size_t magic = sizeof(LUT3D_MAGIC) - 1;
+    memcpy(header, LUT3D_MAGIC, magic);
+    write_u16(header + magic, LUT3D_VERSION);
+    write_u16(header + magic + 2, lut->size);
+    const size_t bytes = lut3d_bytes(lut->size);
+    if (fwrite(header, 1, sizeof(header), out) != sizeof(header) ||
+        fwrite(lut->data, 1, bytes, out) != bytes) {
+        fclose(out);
+        remove(path);
+        return FILE_ERROR;
+    }
+
+    if (fclose(out) != 0) {
+        remove(path);
+        return FILE_ERROR;
+    }
+    return SUCCESS;
+}
+
+void lut3d_free(lut3d *lut) {
+    free(lut->data);
+    lut->data = NULL;
+}
+
+static void lut3d_apply_exact(const lut3d *lut, unsigned char *p1, unsigned char *p2, unsigned char *p3,
+                              size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        const unsigned char *v = lut->data + (((size_t) p1[i] << 16) | ((size_t) p2[i] << 8) | p3[i]) * 3;
+        p1[i] = v[0];
+        p2[i] = v[1];
+        p3[i] = v[2];
+    }
+}
+
+static void lut3d_apply_tetrahedral(const lut3d *lut, unsigned char *p1, unsigned char *p2, unsigned char *p3,
+                                    size_t count) {
+    const size_t sx = (size_t) lut->size * lut->size * 3;
+    const size_t sy = (size_t) lut->size * 3;
+    const size_t sz = 3;
+
+    for (size_t i = 0; i < count; ++i) {
+        const int fx = lut->weight[p1[i]];
+        const int fy = lut->weight[p2[i]];
+        const int fz = lut->weight[p3[i]];
+        const unsigned char *c000 = lut->data + lut->cell[p1[i]] * sx + lut->cell[p2[i]] * sy +
+                                    lut->cell[p3[i]] * sz;
+        const unsigned char *c111 = c000 + sx + sy + sz;
+
+        // the cube is split into six tetrahedra along its main diagonal, each blends four corners
+        const unsigned char *c1;
+        const unsigned char *c2;
+        int w1;
+        int w2;
+        int w3;
+        if (fx >= fy) {
+            if (fy >= fz) {
+                c1 = c000 + sx;
+                c2 = c000 + sx + sy;
+                w1 = fx, w2 = fy, w3 = fz;
+            } else if (fx >= fz) {
+                c1 = c000 + sx;
+                c2 = c000 + sx + sz;
+                w1 = fx, w2 = fz, w3 = fy;
+            } else {
+                c1 = c000 + sz;
+                c2 = c000 + sx + sz;
+                w1 = fz, w2 = fx, w3 = fy;
+            }
+        } else {
+            if (fz >= fy) {
+                c1 = c000 + sz;
+                c2 = c000 + sy + sz;
+                w1 = fz, w2 = fy, w3 = fx;
+            } else if (fz >= fx) {
+                c1 = c000 + sy;
+                c2 = c000 + sy + sz;
+                w1 = fy, w2 = fz, w3 = fx;
+            } else {
+                c1 = c000 + sy;
+                c2 = c000 + sx + sy;
+                w1 = fy, w2 = fx, w3 = fz;
+            }
+        }
+
+        unsigned char *const outs[3] = {&p1[i], &p2[i], &p3[i]};
+        for (int k = 0; k < 3; ++k) {
+            const int v = (c000[k] << LUT3D_WEIGHT_BITS) + w1 * (c1[k] - c000[k]) + w2 * (c2[k] - c1[k]) +
+                          w3 * (c111[k] - c2[k]);
+            *outs[k] = (v + LUT3D_WEIGHT_ONE / 2) >> LUT3D_WEIGHT_BITS;
+        }
+    }
+}
+
+void lut3d_apply_planes(const lut3d *lut, unsigned char *p1, unsigned char *p2, unsigned char *p3, size_t count) {
+    if (lut->size == LUT3D_EXACT) {
+        lut3d_apply_exact(lut, p1, p2, p3, count);
+    } else {
+        lut3d_apply_tetrahedral(lut, p1, p2, p3, count);
+    }
+}
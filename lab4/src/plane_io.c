@@ -0,0 +1,265 @@
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "../include/plane_io.h"
+#include "../include/picture.h"
+#include "../include/defines.h"
+
+#define HEADER_PREFIX 128
+#define READ_BLOCK (1 << 20)
+
+int plane_file_names(const char *pattern, filename names[3]) {
+    const char *end = pattern + strlen(pattern);
+    const char *dot = end;
+    while (*dot != '.' && dot != pattern) {
+        --dot;
+    }
+    if (dot == pattern || end - pattern + 2 >= (long) sizeof(names[0].data)) {
+        return PARSE_ERROR;
+    }
+
+    const size_t body_size = dot - pattern;
+    for (int i = 0; i < 3; ++i) {
+        memcpy(names[i].data, pattern, body_size);
+        names[i].data[body_size] = '_';
+        names[i].data[body_size + 1] = '1' + i;
+        memcpy(names[i].data + body_size + 2, dot, end - dot + 1);
+    }
+    return SUCCESS;
+}
+
+size_t picture_bytes(const picture *pic) {
+    return pic->height * pic->width * pic->pixel_size * (pic->type == P5 ? 1 : 3);
+}
+
+picture *reserve_picture(picture **pic, size_t *capacity, size_t size) {
+    if (*pic != NULL && *capacity >= size) {
+        return *pic;
+    }
+    picture *result = realloc(*pic, sizeof(struct picture) + size);
+    if (!result) {
+        return NULL;
+    }
+    *pic = result;
+    *capacity = size;
+    return result;
+}
+
+int open_picture(const char *name, FILE **file, picture **pic, size_t *capacity) {
+    FILE *in = fopen(name, "rb");
+    if (!in) {
+        return FILE_ERROR;
+    }
+
+    char prefix[HEADER_PREFIX + 1];
+    const size_t prefix_size = fread(prefix, 1, HEADER_PREFIX, in);
+    prefix[prefix_size] = '\0';
+    long file_size;
+    if (ferror(in) || fseek(in, 0, SEEK_END) != 0 || (file_size = ftell(in)) < 0) {
+        fclose(in);
+        return FILE_ERROR;
+    }
+
+    picture header;
+    const char *end = NULL;
+    int ret;
+    // the size check in read_header only needs the total file size, not the data itself
+    if ((ret = read_header(prefix, file_size, &header.type, &header.width, &header.height, &header.max_color,
+                           &header.pixel_size, &end)) != SUCCESS) {
+        fclose(in);
+        return ret;
+    }
+
+    if (fseek(in, end - prefix, SEEK_SET) != 0) {
+        fclose(in);
+        return FILE_ERROR;
+    }
+
+    picture *result = reserve_picture(pic, capacity, picture_bytes(&header));
+    if (!result) {
+        fclose(in);
+        return NOMEM;
+    }
+    memcpy(result, &header, sizeof(struct picture));
+
+    *file = in;
+    return SUCCESS;
+}
+
+int read_picture(const char *name, picture **pic, size_t *capacity) {
+    FILE *in;
+    int ret;
+    if ((ret = open_picture(name, &in, pic, capacity)) != SUCCESS) {
+        return ret;
+    }
+
+    const size_t size = picture_bytes(*pic);
+    const bool complete = fread((*pic)->data, 1, size, in) == size;
+    fclose(in);
+    return complete ? SUCCESS : FILE_ERROR;
+}
+
+int write_picture(picture *pic, const char *name) {
+    FILE *output = fopen(name, "wb");
+    if (!output) {
+        fprintf(stderr, "Error in opening file %s for output", name);
+        return FILE_ERROR;
+    }
+
+    int ret = save_picture(pic, output);
+    if (fclose(output) != 0 && ret == SUCCESS)
+        ret = FILE_ERROR;
+    if (ret != SUCCESS) {
+        const char *reason;
+        switch (ret) {
+            case FILE_ERROR:
+                reason = "io error";
+                break;
+            case LOGIC_ERROR:
+                reason = "output file is null pointer";
+                break;
+            default:
+                reason = "no reason";
+                break;
+        }
+        fprintf(stderr, "%s:can't parse file.", reason);
+    }
+    return ret;
+}
+
+typedef struct {
+    picture *plane;
+    const char *name;
+    int status;
+} write_job;
+
+static void *write_main(void *arg) {
+    write_job *job = arg;
+    job->status = write_picture(job->plane, job->name);
+    return NULL;
+}
+
+int write_planes(picture *const planes[3], const filename names[3]) {
+    write_job jobs[3];
+    pthread_t threads[3];
+    bool started[3] = {};
+    for (int i = 0; i < 3; ++i) {
+        jobs[i] = (write_job) {.plane = planes[i], .name = names[i].data, .status = SUCCESS};
+    }
+
+    // the calling thread writes the first plane itself
+    for (int i = 1; i < 3; ++i) {
+        started[i] = pthread_create(&threads[i], NULL, write_main, &jobs[i]) == 0;
+    }
+    for (int i = 0; i < 3; ++i) {
+        if (!started[i])
+            write_main(&jobs[i]);
+    }
+
+    int ret = SUCCESS;
+    for (int i = 0; i < 3; ++i) {
+        if (started[i])
+            pthread_join(threads[i], NULL);
+        if (ret == SUCCESS)
+            ret = jobs[i].status;
+    }
+    return ret;
+}
+
+int plane_reader_open(plane_reader *reader, const filename names[3], picture *planes[3], size_t capacity[3]) {
+    memset(reader, 0, sizeof(*reader));
+    for (int i = 0; i < 3; ++i) {
+        int ret;
+        if ((ret = open_picture(names[i].data, &reader->files[i], &planes[i], &capacity[i])) != SUCCESS) {
+            for (int j = 0; j < i; ++j) {
+                fclose(reader->files[j]);
+            }
+            return ret;
+        }
+        reader->planes[i] = planes[i];
+    }
+    pthread_mutex_init(&reader->mutex, NULL);
+    pthread_cond_init(&reader->progress, NULL);
+    return SUCCESS;
+}
+
+static void *read_main(void *arg) {
+    const plane_read_job *job = arg;
+    plane_reader *reader = job->reader;
+    const int i = job->index;
+    picture *plane = reader->planes[i];
+    const size_t size = picture_bytes(plane);
+
+    size_t loaded = 0;
+    int status = SUCCESS;
+    while (loaded < size) {
+        const size_t block = size - loaded < READ_BLOCK ? size - loaded : READ_BLOCK;
+        const size_t n = fread(plane->data + loaded, 1, block, reader->files[i]);
+        if (n == 0) {
+            status = FILE_ERROR;
+            break;
+        }
+        loaded += n;
+
+        pthread_mutex_lock(&reader->mutex);
+        reader->loaded[i] = loaded;
+        pthread_cond_broadcast(&reader->progress);
+        pthread_mutex_unlock(&reader->mutex);
+    }
+
+    pthread_mutex_lock(&reader->mutex);
+    // a failed plane stops holding back the waiting caller, plane_reader_finish reports the error
+    reader->status[i] = status;
+    reader->loaded[i] = size;
+    pthread_cond_broadcast(&reader->progress);
+    pthread_mutex_unlock(&reader->mutex);
+    return NULL;
+}
+
+void plane_reader_start(plane_reader *reader) {
+    for (int i = 0; i < 3; ++i) {
+        reader->jobs[i] = (plane_read_job) {.reader = reader, .index = i};
+        reader->started[i] = pthread_create(&reader->threads[i], NULL, read_main, &reader->jobs[i]) == 0;
+        // without a thread the plane is read right away
+        if (!reader->started[i])
+            read_main(&reader->jobs[i]);
+    }
+}
+
+size_t plane_reader_wait_rows(plane_reader *reader, size_t rows) {
+    size_t available;
+    pthread_mutex_lock(&reader->mutex);
+    for (;;) {
+        available = (size_t) -1;
+        for (int i = 0; i < 3; ++i) {
+            const picture *plane = reader->planes[i];
+            const size_t row_size = plane->width * plane->pixel_size;
+            const size_t plane_rows = row_size ? reader->loaded[i] / row_size : plane->height;
+            if (plane_rows < available)
+                available = plane_rows;
+        }
+        if (available >= rows)
+            break;
+        pthread_cond_wait(&reader->progress, &reader->mutex);
+    }
+    pthread_mutex_unlock(&reader->mutex);
+    return available;
+}
+
+int plane_reader_finish(plane_reader *reader) {
+    int ret = SUCCESS;
+    for (int i = 0; i < 3; ++i) {
+        if (reader->started[i])
+            pthread_join(reader->threads[i], NULL);
+        reader->started[i] = false;
+        if (reader->files[i] != NULL)
+            fclose(reader->files[i]);
+        reader->files[i] = NULL;
+        if (ret == SUCCESS)
+            ret = reader->status[i];
+    }
+    pthread_cond_destroy(&reader->progress);
+    pthread_mutex_destroy(&reader->mutex);
+    return ret;
+}
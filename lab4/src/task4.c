@@ -4,72 +4,24 @@
 #include <string.h>
 #include <assert.h>
 #include <stdbool.h>
+#include <errno.h>
 
 #include "../include/utility.h"
 #include "../include/defines.h"
 #include "../include/picture.h"
 #include "../include/color_space.h"
+#include "../include/lut3d.h"
+#include "../include/chroma.h"
+#include "../include/conversion.h"
+#include "../include/thread_pool.h"
+#include "../include/plane_io.h"
+#include "../include/batch.h"
 
 #define USAGE "usage:\n%s  -f <from_color_space> -t <to_color_space>" \
-"  -i <count> <input_file_name> -o <count> <output_file_name>\n"
-
-const to_rgb_pixel_func to_rgb_funcs[] = {
-        [RGB] = noop,
-        [HSL] = hsl_to_rgb_pixel,
-        [HSV] = hsv_to_rgb_pixel,
-        [YCbCr_601] = YCbCr_601_to_rgb_pixel,
-        [YCbCr_709] = YCbCr_709_to_rgb_pixel,
-        [YCoCg] = YCoCg_to_rgb_pixel,
-        [CMY] = CMY_to_rgb_pixel
-};
-
-const from_rgb_pixel_func from_rgb_funcs[] = {
-        [RGB] = noop,
-        [HSL] = hsl_from_rgb_pixel,
-        [HSV] = hsv_from_rgb_pixel,
-        [YCbCr_601] = YCbCr_601_from_rgb_pixel,
-        [YCbCr_709] = YCbCr_709_from_rgb_pixel,
-        [YCoCg] = YCoCg_from_rgb_pixel,
-        [CMY] = CMY_from_rgb_pixel
-};
-
-static void to_rgb(color_sources sources, to_rgb_pixel_func func) {
-    assert(sources.sources[0]->type == P5);
-    assert(sources.sources[1]->type == P5);
-    assert(sources.sources[2]->type == P5);
-    assert(sources.sources[0]->width == sources.sources[1]->width &&
-           sources.sources[1]->width == sources.sources[2]->width &&
-           sources.sources[0]->width == sources.sources[2]->width &&
-           sources.sources[0]->height == sources.sources[1]->height &&
-           sources.sources[1]->height == sources.sources[2]->height &&
-           sources.sources[0]->height == sources.sources[2]->height
-    );
-
-    for (size_t i = 0; i < sources.sources[0]->width * sources.sources[0]->height; ++i) {
-        func(&sources.sources[0]->data[i],
-             &sources.sources[1]->data[i],
-             &sources.sources[2]->data[i]);
-    }
-}
-
-static void from_rgb(color_sources sources, from_rgb_pixel_func func) {
-    assert(sources.sources[0]->type == P5);
-    assert(sources.sources[1]->type == P5);
-    assert(sources.sources[2]->type == P5);
-    assert(sources.sources[0]->width == sources.sources[1]->width &&
-           sources.sources[1]->width == sources.sources[2]->width &&
-           sources.sources[0]->width == sources.sources[2]->width &&
-           sources.sources[0]->height == sources.sources[1]->height &&
-           sources.sources[1]->height == sources.sources[2]->height &&
-           sources.sources[0]->height == sources.sources[2]->height
-    );
-
-    for (size_t i = 0; i < sources.sources[0]->width * sources.sources[0]->height; ++i) {
-        func(&sources.sources[0]->data[i],
-             &sources.sources[1]->data[i],
-             &sources.sources[2]->data[i]);
-    }
-}
+"  -i <count> <input_file_name> -o <count> <output_file_name> [-p fixed|float]" \
+"  [-l 17|33|65|256] [-c <lut_cache_dir>] [-s 444|422|420] [-j <threads>]\n" \
+"or, for many files,\n%s  -f <from_color_space> -t <to_color_space> -i <count> -o <count>" \
+"  -b <list_file|glob> [...]\n"
 
 color_space from_string(char *s) {
     assert(s != NULL);
@@ -83,43 +35,61 @@ color_space from_string(char *s) {
         return YCbCr_601;
     else if (!strncmp(s, "YCbCr_709", sizeof("YCbCr_709") - 1))
         return YCbCr_709;
+    else if (!strncmp(s, "YCoCg_R", sizeof("YCoCg_R") - 1))
+        return YCoCg_R;
     else if (!strncmp(s, "YCoCg", sizeof("YCoCg") - 1))
         return YCoCg;
     else if (!strncmp(s, "CMY", sizeof("CMY") - 1))
         return CMY;
+    else if (!strncmp(s, "XYZ", sizeof("XYZ") - 1))
+        return XYZ;
+    else if (!strncmp(s, "Lab", sizeof("Lab") - 1))
+        return Lab;
     assert(true);
 }
 
+static bool batch_requested(char **argv) {
+    for (; *argv != NULL; ++argv) {
+        if (!strcmp(*argv, "-b"))
+            return true;
+    }
+    return false;
+}
+
 int main(int argc, char *argv[]) {
-    if (argc != 11) {
-        fprintf(stderr, USAGE, argv[0]);
+    ++argv;
+    char **sv = argv - 1;
+    // in batch mode -i and -o only take the count, the names come from the -b list
+    const bool batch = batch_requested(argv);
+    if (argc < 11 || argc % 2 == 0) {
+        fprintf(stderr, USAGE, sv[0], sv[0]);
         return EXIT_FAILURE;
     }
 
-    ++argv;
     color_space from = -1;
     color_space to = -1;
+    arithmetic arithmetic = FIXED_POINT;
+    int lut_size = 0;
+    const char *lut_cache = NULL;
+    chroma_format output_chroma = CHROMA_444;
+    lut3d lut = {};
+    int threads = default_thread_count();
+    thread_pool *pool = NULL;
     int input_file_count = 0;
     int output_file_count = 0;
-    char **sv = argv;
-    picture *input_pictures[3] = {};
-    picture *input_picture = NULL;
-    filename output_file_names[3] = {};
-    char *datas[3] = {};
-    FILE *input = NULL;
+    const char *input_name = NULL;
+    const char *output_name = NULL;
+    const char *batch_list = NULL;
+    filename names[3];
     while (*argv != NULL) {
         char *arg_it = *argv;
         if (*arg_it != '-') {
-            fprintf(stderr, USAGE,
-                    sv[0]);
-            goto clear;
+            goto usage;
         }
 
         ++argv;
-        if (!argv) {
-            fprintf(stderr, USAGE,
-                    sv[0]);
-            goto clear;
+        if (!*argv) {
+            goto usage;
         }
         switch (arg_it[1]) {
             case 'f':
@@ -128,322 +98,161 @@ int main(int argc, char *argv[]) {
             case 't':
                 to = from_string(*argv);
                 break;
-            case 'i':
-                READ_INT(input_file_count, *argv, {
-                    perror("error in parsing <count>.");
-                    goto clear;
-                }, strtol);
-                if (input_file_count != 1 && input_file_count != 3) {
-                    fprintf(stderr, USAGE,
-                            sv[0]);
-                    goto clear;
+            case 'p':
+                if (!strcmp(*argv, "fixed")) {
+                    arithmetic = FIXED_POINT;
+                } else if (!strcmp(*argv, "float")) {
+                    arithmetic = FLOATING_POINT;
+                } else {
+                    goto usage;
                 }
-                filename file_names[3] = {};
-                if (input_file_count == 1) {
-                    ++argv;
-                    if (!argv) {
-                        fprintf(stderr, USAGE,
-                                sv[0]);
-                        goto clear;
-                    }
-                    memcpy(file_names[0].data, *argv, strlen(*argv) + 1);
+                break;
+            case 'l':
+                READ_INT(lut_size, *argv, {
+                    perror("error in parsing <grid>.");
+                    return EXIT_FAILURE;
+                }, strtol);
+                if (!lut3d_valid_size(lut_size)) {
+                    goto usage;
                 }
-
-                if (input_file_count == 3) {
-                    ++argv;
-                    if (!argv) {
-                        fprintf(stderr, USAGE,
-                                sv[0]);
-                        goto clear;
-                    }
-                    char *pattern = *argv;
-                    char *end = pattern + strlen(pattern);
-                    char *dot = end;
-                    while (*dot != '.' && dot != pattern) {
-                        --dot;
-                    }
-                    if (dot == pattern) {
-                        fprintf(stderr, USAGE,
-                                sv[0]);
-                        goto clear;
-                    }
-
-                    size_t body_size = dot - pattern;
-                    memcpy(file_names[0].data, pattern, dot - pattern);
-                    memcpy(file_names[1].data, pattern, dot - pattern);
-                    memcpy(file_names[2].data, pattern, dot - pattern);
-
-                    memcpy(file_names[0].data + body_size, "_1", 2);
-                    memcpy(file_names[1].data + body_size, "_2", 2);
-                    memcpy(file_names[2].data + body_size, "_3", 2);
-
-                    memcpy(file_names[0].data + body_size + 2, dot, end - dot + 1);
-                    memcpy(file_names[1].data + body_size + 2, dot, end - dot + 1);
-                    memcpy(file_names[2].data + body_size + 2, dot, end - dot + 1);
+                break;
+            case 'c':
+                lut_cache = *argv;
+                break;
+            case 's':
+                if (chroma_format_from_string(*argv, &output_chroma) != SUCCESS) {
+                    goto usage;
                 }
-
-                for (int i = 0; i < input_file_count; ++i) {
-                    if (input != NULL)
-                        fclose(input);
-                    input = fopen(file_names[i].data, "rb");
-                    if (!input) {
-                        goto clear;
-                    }
-                    size_t sz;
-                    int ret;
-                    if ((ret = read_all(input, &datas[i], &sz))) {
-                        const char *reason;
-                        switch (ret) {
-                            case NOMEM:
-                                reason = "no mem";
-                                break;
-                            case FILE_ERROR:
-                                reason = "file error";
-                                break;
-                            case OVERFLOW_ERROR:
-                                reason = "overflow";
-                                break;
-                            case LOGIC_ERROR:
-                                reason = "logic error";
-                                break;
-                            default:
-                                reason = "no reason";
-                                break;
-                        }
-                        fprintf(stderr, "%s: can't read all input file.", reason);
-                        goto clear;
-                    }
-                    input_pictures[i] = malloc(sizeof(struct picture) + sz * sizeof(char));
-                    if (!input_pictures[i]) {
-                        fprintf(stderr, "NOMEM: can't allocate memory for picture.");
-                        goto clear;
-                    }
-
-                    const char *end = NULL;
-                    if ((ret = read_header(datas[i], sz, &input_pictures[i]->type, &input_pictures[i]->width,
-                                           &input_pictures[i]->height,
-                                           &input_pictures[i]->max_color,
-                                           &input_pictures[i]->pixel_size, &end)) != SUCCESS) {
-                        const char *reason;
-                        switch (ret) {
-                            case PARSE_ERROR:
-                                reason = "wrong file format";
-                                break;
-                            case LOGIC_ERROR:
-                                reason = "actual size doesn't match with size in header";
-                                break;
-                            default:
-                                reason = "no reason";
-                                break;
-                        }
-                        fprintf(stderr, "%s:can't parse file.", reason);
-                        goto clear;
-                    }
-
-                    memcpy(input_pictures[i]->data, end,
-                           input_pictures[i]->height * input_pictures[i]->width * input_pictures[i]->pixel_size *
-                           (input_pictures[i]->type == P5 ? 1 : 3));
+                break;
+            case 'j':
+                READ_INT(threads, *argv, {
+                    perror("error in parsing <threads>.");
+                    return EXIT_FAILURE;
+                }, strtol);
+                if (threads < 1) {
+                    goto usage;
                 }
                 break;
-
-            case 'o':
-                READ_INT(output_file_count, *argv, {
+            case 'b':
+                batch_list = *argv;
+                break;
+            case 'i':
+            case 'o': {
+                int count;
+                READ_INT(count, *argv, {
                     perror("error in parsing <count>.");
-                    goto clear;
+                    return EXIT_FAILURE;
                 }, strtol);
-
-                if (output_file_count != 1 && output_file_count != 3) {
-                    fprintf(stderr, USAGE,
-                            sv[0]);
-                    goto clear;
+                if (count != 1 && count != 3) {
+                    goto usage;
                 }
 
-                if (output_file_count == 1) {
+                const char *name = NULL;
+                if (!batch) {
                     ++argv;
-                    if (!argv) {
-                        fprintf(stderr, USAGE,
-                                sv[0]);
-                        goto clear;
+                    if (!*argv) {
+                        goto usage;
                     }
-                    memcpy(output_file_names[0].data, *argv, strlen(*argv) + 1);
-                }
-
-                if (output_file_count == 3) {
-                    ++argv;
-                    if (!argv) {
-                        fprintf(stderr, USAGE,
-                                sv[0]);
-                        goto clear;
-                    }
-                    char *pattern = *argv;
-                    char *end = pattern + strlen(pattern);
-                    char *dot = end;
-                    while (*dot != '.' && dot != pattern) {
-                        --dot;
+                    name = *argv;
+                    // a <name.ext> pattern for the three plane files
+                    if ((count == 1 && strlen(name) >= sizeof(names[0].data)) ||
+                        (count == 3 && plane_file_names(name, names) != SUCCESS)) {
+                        goto usage;
                     }
-                    if (dot == pattern) {
-                        fprintf(stderr, USAGE,
-                                sv[0]);
-                        goto clear;
-                    }
-
-                    size_t body_size = dot - pattern;
-                    memcpy(output_file_names[0].data, pattern, dot - pattern);
-                    memcpy(output_file_names[1].data, pattern, dot - pattern);
-                    memcpy(output_file_names[2].data, pattern, dot - pattern);
-
-                    memcpy(output_file_names[0].data + body_size, "_1", 2);
-                    memcpy(output_file_names[1].data + body_size, "_2", 2);
-                    memcpy(output_file_names[2].data + body_size, "_3", 2);
+                }
 
-                    memcpy(output_file_names[0].data + body_size + 2, dot, end - dot + 1);
-                    memcpy(output_file_names[1].data + body_size + 2, dot, end - dot + 1);
-                    memcpy(output_file_names[2].data + body_size + 2, dot, end - dot + 1);
+                if (arg_it[1] == 'i') {
+                    input_file_count = count;
+                    input_name = name;
+                } else {
+                    output_file_count = count;
+                    output_name = name;
                 }
                 break;
+            }
             default:
-                fprintf(stderr, USAGE,
-                        sv[0]);
-                return EXIT_FAILURE;
+                goto usage;
         }
 
         ++argv;
         continue;
-        clear:
-        free(input_pictures[2]);
-        free(input_pictures[1]);
-        free(input_pictures[0]);
-        free(datas[2]);
-        free(datas[1]);
-        free(datas[0]);
-        if (input != NULL)
-            fclose(input);
+        usage:
+        fprintf(stderr, USAGE, sv[0], sv[0]);
+        return EXIT_FAILURE;
+    }
 
+    if (input_file_count == 0 || output_file_count == 0 || (batch && batch_list == NULL)) {
+        fprintf(stderr, USAGE, sv[0], sv[0]);
         return EXIT_FAILURE;
     }
-    free(datas[2]);
-    free(datas[1]);
-    free(datas[0]);
 
-    if (input_file_count == 1) {
-        input_picture = input_pictures[0];
-        const size_t sz = input_picture->width * input_picture->height;
-        input_pictures[0] = malloc(sizeof(struct picture) + sz * sizeof(char));
-        if (!input_pictures[0]) {
-            goto error_clear;
-        }
-        input_pictures[1] = malloc(sizeof(struct picture) + sz * sizeof(char));
-        if (!input_pictures[1]) {
-            goto error_clear0;
-        }
-        input_pictures[2] = malloc(sizeof(struct picture) + sz * sizeof(char));
-        if (!input_pictures[2]) {
-            goto error_clear1;
-        }
+    if ((from == YCoCg_R && input_file_count != 3) || (to == YCoCg_R && output_file_count != 3)) {
+        fprintf(stderr, "YCoCg_R keeps 9-bit chroma and needs 3 pgm files.");
+        return EXIT_FAILURE;
+    }
 
-        for (int i = 0; i < 3; ++i) {
-            input_pictures[i]->height = input_picture->height;
-            input_pictures[i]->width = input_picture->width;
-            input_pictures[i]->type = P5;
-        }
+    if (output_chroma != CHROMA_444 && (output_file_count != 3 || (to != YCbCr_601 && to != YCbCr_709 &&
+                                                                     to != YCoCg))) {
+        fprintf(stderr, "chroma subsampling needs -o 3 and a luma/chroma output colour space.");
+        return EXIT_FAILURE;
+    }
 
-        for (int i = 0; i < input_picture->width; ++i) {
-            for (int j = 0; j < input_picture->height; ++j) {
-                const char *arr = get_data(input_picture, i, j);
-                *get_data(input_pictures[0], i, j) = arr[0];
-                *get_data(input_pictures[1], i, j) = arr[1];
-                *get_data(input_pictures[2], i, j) = arr[2];
-            }
+    batch_source source;
+    if (batch) {
+        if (batch_source_open(&source, batch_list, color_space_names[to], output_file_count) != SUCCESS) {
+            fprintf(stderr, "can't open batch list or match any file with %s.", batch_list);
+            return EXIT_FAILURE;
+        }
+        if (source.globbed && input_file_count != 1) {
+            fprintf(stderr, "a glob only matches single input files, use a list for -i 3.");
+            batch_source_close(&source);
+            return EXIT_FAILURE;
         }
+    } else {
+        batch_source_single(&source, input_name, output_name);
     }
 
-    color_sources sources = {
-            .sources = {
-                    [0] = input_pictures[0],
-                    [1] = input_pictures[1],
-                    [2] = input_pictures[2]
-            }
-    };
+    int result = EXIT_FAILURE;
 
-    to_rgb(sources, to_rgb_funcs[from]);
-    from_rgb(sources, to_rgb_funcs[to]);
+    // YCoCg_R is lifted to and from 8-bit RGB planes around the ordinary conversion
+    const color_space stage_from = from == YCoCg_R ? RGB : from;
+    const color_space stage_to = to == YCoCg_R ? RGB : to;
 
-    if (output_file_count == 1) {
-        if (input != NULL)
-            fclose(input);
-        input = fopen(output_file_names[0].data, "wb");
-        if (!input) {
-            fprintf(stderr, "Error in opening file %s for output", output_file_names[0].data);
-            goto error_clear2;
-        }
-        for (size_t i = 0; i < input_picture->height * input_picture->width; ++i) {
-            unsigned char *arr = &input_picture->data[i];
-            arr[0] = sources.sources[0]->data[i];
-            arr[1] = sources.sources[1]->data[i];
-            arr[2] = sources.sources[2]->data[i];
-        }
+    if (lut_size != 0 && stage_from != stage_to) {
         int ret;
-        if ((ret = save_picture(input_picture, input)) != SUCCESS) {
-            const char *reason;
-            switch (ret) {
-                case FILE_ERROR:
-                    reason = "io error";
-                    break;
-                case LOGIC_ERROR:
-                    reason = "output file is null pointer";
-                    break;
-                default:
-                    reason = "no reason";
-                    break;
-            }
-            fprintf(stderr, "%s:can't parse file.", reason);
-            goto error_clear2;
-        }
-    } else if (output_file_count == 3) {
-        for (int i = 0; i < output_file_count; ++i) {
-            if (input != NULL)
-                fclose(input);
-            input = fopen(output_file_names[i].data, "wb");
-            if (!input) {
-                fprintf(stderr, "Error in opening file %s for output", output_file_names[0].data);
-                goto error_clear2;
-            }
-            int ret;
-            if ((ret = save_picture(sources.sources[i], input)) != SUCCESS) {
-                const char *reason;
-                switch (ret) {
-                    case FILE_ERROR:
-                        reason = "io error";
-                        break;
-                    case LOGIC_ERROR:
-                        reason = "output file is null pointer";
-                        break;
-                    default:
-                        reason = "no reason";
-                        break;
-                }
-                fprintf(stderr, "%s:can't parse file.", reason);
-                goto error_clear2;
-            }
+        if ((ret = prepare_lut(&lut, lut_size, stage_from, stage_to, lut_cache)) != SUCCESS) {
+            fprintf(stderr, "%s: can't build colour lut.", ret == NOMEM ? "no mem" : "no reason");
+            goto clear;
         }
     }
 
-    free(input_pictures[2]);
-    free(input_pictures[1]);
-    free(input_pictures[0]);
-    free(input_picture);
-    if (input != NULL)
-        fclose(input);
-    return EXIT_SUCCESS;
-    error_clear2:
-    free(input_pictures[2]);
-    error_clear1:
-    free(input_pictures[1]);
-    error_clear0:
-    free(input_pictures[0]);
-    error_clear:
-    free(input_picture);
-    if (input != NULL)
-        fclose(input);
-    return EXIT_FAILURE;
-}
\ No newline at end of file
+    conversion conv;
+    conversion_init(&conv, stage_from, stage_to, arithmetic, lut.data != NULL ? &lut : NULL);
+
+    pool = thread_pool_create(threads);
+    if (!pool) {
+        fprintf(stderr, "NOMEM: can't create thread pool.");
+        goto clear;
+    }
+
+    const batch_context context = {
+            .from = from,
+            .to = to,
+            .input_file_count = input_file_count,
+            .output_file_count = output_file_count,
+            .output_chroma = output_chroma,
+            .conv = &conv,
+            .pool = pool
+    };
+    const size_t failed = batch_run(&context, &source);
+    if (batch && failed > 0)
+        fprintf(stderr, "%zu files failed.\n", failed);
+    if (failed == 0)
+        result = EXIT_SUCCESS;
+
+    clear:
+    thread_pool_destroy(pool);
+    lut3d_free(&lut);
+    batch_source_close(&source);
+    return result;
+}
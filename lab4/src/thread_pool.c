@@ -0,0 +1,150 @@
+#include <stdlib.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "../include/thread_pool.h"
+
+struct thread_pool {
+    pthread_t *workers;
+    int worker_count;
+
+    pthread_mutex_t mutex;
+    pthread_cond_t start;
+    pthread_cond_t done;
+    unsigned long generation;
+    int running;
+    bool stop;
+
+    parallel_for_func func;
+    void *context;
+    size_t count;
+    size_t grain;
+    size_t next;
+};
+
+int default_thread_count(void) {
+#ifdef _SC_NPROCESSORS_ONLN
+    const long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int) n : 1;
+#else
+    return 1;
+#endif
+}
+
+static void run_chunks(thread_pool *pool) {
+    for (;;) {
+        pthread_mutex_lock(&pool->mutex);
+        const size_t begin = pool->next;
+        pool->next += pool->grain;
+        pthread_mutex_unlock(&pool->mutex);
+
+        if (begin >= pool->count)
+            return;
+        const size_t end = pool->count - begin < pool->grain ? pool->count : begin + pool->grain;
+        pool->func(pool->context, begin, end);
+    }
+}
+
+static void *worker_main(void *arg) {
+    thread_pool *pool = arg;
+    unsigned long seen = 0;
+
+    pthread_mutex_lock(&pool->mutex);
+    for (;;) {
+        while (!pool->stop && pool->generation == seen) {
+            pthread_cond_wait(&pool->start, &pool->mutex);
+        }
+        if (pool->stop)
+            break;
+        seen = pool->generation;
+        pthread_mutex_unlock(&pool->mutex);
+
+        run_chunks(pool);
+
+        pthread_mutex_lock(&pool->mutex);
+        if (--pool->running == 0)
+            pthread_cond_signal(&pool->done);
+    }
+    pthread_mutex_unlock(&pool->mutex);
+    return NULL;
+}
+
+thread_pool *thread_pool_create(int threads) {
+    thread_pool *pool = calloc(1, sizeof(thread_pool));
+    if (!pool) {
+        return NULL;
+    }
+
+    pthread_mutex_init(&pool->mutex, NULL);
+    pthread_cond_init(&pool->start, NULL);
+    pthread_cond_init(&pool->done, NULL);
+
+    if (threads > 1) {
+        pool->workers = malloc((threads - 1) * sizeof(pthread_t));
+        if (!pool->workers) {
+            thread_pool_destroy(pool);
+            return NULL;
+        }
+        for (int i = 0; i < threads - 1; ++i) {
+            if (pthread_create(&pool->workers[i], NULL, worker_main, pool) != 0)
+                break;
+            ++pool->worker_count;
+        }
+    }
+
+    return pool;
+}
+
+void thread_pool_destroy(thread_pool *pool) {
+    if (!pool)
+        return;
+
+    pthread_mutex_lock(&pool->mutex);
+    pool->stop = true;
+    pthread_cond_broadcast(&pool->start);
+    pthread_mutex_unlock(&pool->mutex);
+
+    for (int i = 0; i < pool->worker_count; ++i) {
+        pthread_join(pool->workers[i], NULL);
+    }
+
+    pthread_cond_destroy(&pool->done);
+    pthread_cond_destroy(&pool->start);
+    pthread_mutex_destroy(&pool->mutex);
+    free(pool->workers);
+    free(pool);
+}
+
+int thread_pool_threads(const thread_pool *pool) {
+    return pool ? pool->worker_count + 1 : 1;
+}
+
+void parallel_for(thread_pool *pool, size_t count, size_t grain, parallel_for_func func, void *context) {
+    if (grain == 0)
+        grain = 1;
+    if (!pool || pool->worker_count == 0 || count <= grain) {
+        if (count > 0)
+            func(context, 0, count);
+        return;
+    }
+
+    pthread_mutex_lock(&pool->mutex);
+    pool->func = func;
+    pool->context = context;
+    pool->count = count;
+    pool->grain = grain;
+    pool->next = 0;
+    pool->running = pool->worker_count;
+    ++pool->generation;
+    pthread_cond_broadcast(&pool->start);
+    pthread_mutex_unlock(&pool->mutex);
+
+    run_chunks(pool);
+
+    pthread_mutex_lock(&pool->mutex);
+    while (pool->running > 0) {
+        pthread_cond_wait(&pool->done, &pool->mutex);
+    }
+    pthread_mutex_unlock(&pool->mutex);
+}
@@ -0,0 +1,98 @@
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../include/ycc_fixed.h"
+#include "../include/color_space.h"
+#include "../include/defines.h"
+
+/*
+ * Integer YCbCr transforms in the style of libjpeg's jccolor.c/jdcolor.c: every coefficient is
+ * pre-multiplied by all 256 sample values in 16-bit fixed point, so a pixel costs a few table lookups
+ * and adds, and the rounding matches the integer reference bit for bit.
+ */
+
+#define ONE_HALF ((int32_t) 1 << (YCC_SCALEBITS - 1))
+#define CBCR_OFFSET ((int32_t) 128 << YCC_SCALEBITS)
+#define FIX(x) ((int32_t) ((x) * (1L << YCC_SCALEBITS) + 0.5))
+
+// same constants as libjpeg
+static const ycc_coefficients YCbCr_601_coefficients = {
+        .r_y = 0.29900, .g_y = 0.58700, .b_y = 0.11400,
+        .r_cb = 0.16874, .g_cb = 0.33126,
+        .g_cr = 0.41869, .b_cr = 0.08131,
+        .cr_r = 1.40200, .cb_b = 1.77200,
+        .cr_g = 0.71414, .cb_g = 0.34414
+};
+
+static const ycc_coefficients YCbCr_709_coefficients = {
+        .r_y = 0.21260, .g_y = 0.71520, .b_y = 0.07220,
+        .r_cb = 0.11457, .g_cb = 0.38543,
+        .g_cr = 0.45415, .b_cr = 0.04585,
+        .cr_r = 1.57480, .cb_b = 1.85560,
+        .cr_g = 0.46812, .cb_g = 0.18732
+};
+
+void ycc_tables_init(ycc_tables *tables, const ycc_coefficients *k) {
+    for (int32_t i = 0; i < 256; ++i) {
+        tables->r_y[i] = FIX(k->r_y) * i;
+        tables->g_y[i] = FIX(k->g_y) * i;
+        tables->b_y[i] = FIX(k->b_y) * i + ONE_HALF;
+        tables->r_cb[i] = -FIX(k->r_cb) * i;
+        tables->g_cb[i] = -FIX(k->g_cb) * i;
+        // B=>Cb and R=>Cr share this entry, ONE_HALF - 1 keeps the maximum at 255
+        tables->b_cb[i] = FIX(0.5) * i + CBCR_OFFSET + ONE_HALF - 1;
+        tables->g_cr[i] = -FIX(k->g_cr) * i;
+        tables->b_cr[i] = -FIX(k->b_cr) * i;
+
+        const int32_t x = i - 128;
+        tables->cr_r[i] = (FIX(k->cr_r) * x + ONE_HALF) >> YCC_SCALEBITS;
+        tables->cb_b[i] = (FIX(k->cb_b) * x + ONE_HALF) >> YCC_SCALEBITS;
+        tables->cr_g[i] = -FIX(k->cr_g) * x;
+        tables->cb_g[i] = -FIX(k->cb_g) * x + ONE_HALF;
+    }
+
+    for (int i = 0; i < 3 * 256; ++i) {
+        const int v = i - 256;
+        tables->range_limit[i] = v < 0 ? 0 : (v > 255 ? 255 : v);
+    }
+}
+
+int ycc_tables_for(color_space space, ycc_tables *tables) {
+    switch (space) {
+        case YCbCr_601:
+            ycc_tables_init(tables, &YCbCr_601_coefficients);
+            return SUCCESS;
+        case YCbCr_709:
+            ycc_tables_init(tables, &YCbCr_709_coefficients);
+            return SUCCESS;
+        default:
+            return LOGIC_ERROR;
+    }
+}
+
+void ycc_from_rgb_planes(const ycc_tables *tables, unsigned char *p1, unsigned char *p2, unsigned char *p3,
+                         size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        const int r = p1[i];
+        const int g = p2[i];
+        const int b = p3[i];
+
+        p1[i] = (tables->r_y[r] + tables->g_y[g] + tables->b_y[b]) >> YCC_SCALEBITS;
+        p2[i] = (tables->r_cb[r] + tables->g_cb[g] + tables->b_cb[b]) >> YCC_SCALEBITS;
+        p3[i] = (tables->b_cb[r] + tables->g_cr[g] + tables->b_cr[b]) >> YCC_SCALEBITS;
+    }
+}
+
+void ycc_to_rgb_planes(const ycc_tables *tables, unsigned char *p1, unsigned char *p2, unsigned char *p3,
+                       size_t count) {
+    const unsigned char *limit = tables->range_limit + 256;
+    for (size_t i = 0; i < count; ++i) {
+        const int y = p1[i];
+        const int cb = p2[i];
+        const int cr = p3[i];
+
+        p1[i] = limit[y + tables->cr_r[cr]];
+        p2[i] = limit[y + ((tables->cb_g[cb] + tables->cr_g[cr]) >> YCC_SCALEBITS)];
+        p3[i] = limit[y + tables->cb_b[cb]];
+    }
+}
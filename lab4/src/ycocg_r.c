@@ -0,0 +1,96 @@
+#include <stddef.h>
+
+#include "../include/ycocg_r.h"
+#include "../include/thread_pool.h"
+
+/*
+ * YCoCg-R (Malvar & Sullivan): the YCoCg matrix written as lifting steps, so both directions need
+ * only integer adds and shifts and the inverse undoes the forward transform exactly.
+ * Y keeps 8 bits, Co and Cg grow to 9 bits.
+ */
+
+#define ROWS_GRAIN_PIXELS 65536
+
+static void store_chroma(unsigned char *plane, size_t i, int v) {
+    v += YCOCG_R_CHROMA_OFFSET;
+    plane[2 * i] = v >> 8;
+    plane[2 * i + 1] = v & 0xff;
+}
+
+static int load_chroma(const unsigned char *plane, size_t i) {
+    return (plane[2 * i] << 8 | plane[2 * i + 1]) - YCOCG_R_CHROMA_OFFSET;
+}
+
+static unsigned char clamp(int v) {
+    return v < 0 ? 0 : v > 255 ? 255 : v;
+}
+
+void ycocg_r_from_rgb_planes(const unsigned char *r, const unsigned char *g, const unsigned char *b,
+                             unsigned char *y, unsigned char *co, unsigned char *cg, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        const int co_i = r[i] - b[i];
+        const int t = b[i] + (co_i >> 1);
+        const int cg_i = g[i] - t;
+        y[i] = t + (cg_i >> 1);
+        store_chroma(co, i, co_i);
+        store_chroma(cg, i, cg_i);
+    }
+}
+
+void ycocg_r_to_rgb_planes(const unsigned char *y, const unsigned char *co, const unsigned char *cg,
+                           unsigned char *r, unsigned char *g, unsigned char *b, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        const int co_i = load_chroma(co, i);
+        const int cg_i = load_chroma(cg, i);
+        const int t = y[i] - (cg_i >> 1);
+        const int b_i = t - (co_i >> 1);
+        // exact for planes written by ycocg_r_from_rgb_planes, the clamps only guard foreign input
+        g[i] = clamp(cg_i + t);
+        b[i] = clamp(b_i);
+        r[i] = clamp(b_i + co_i);
+    }
+}
+
+typedef struct {
+    const unsigned char *src[3];
+    unsigned char *dst[3];
+    size_t width;
+} rows_job;
+
+static void from_rgb_rows(void *context, size_t begin, size_t end) {
+    const rows_job *job = context;
+    const size_t offset = begin * job->width;
+    ycocg_r_from_rgb_planes(job->src[0] + offset, job->src[1] + offset, job->src[2] + offset,
+                            job->dst[0] + offset, job->dst[1] + 2 * offset, job->dst[2] + 2 * offset,
+                            (end - begin) * job->width);
+}
+
+static void to_rgb_rows(void *context, size_t begin, size_t end) {
+    const rows_job *job = context;
+    const size_t offset = begin * job->width;
+    ycocg_r_to_rgb_planes(job->src[0] + offset, job->src[1] + 2 * offset, job->src[2] + 2 * offset,
+                          job->dst[0] + offset, job->dst[1] + offset, job->dst[2] + offset,
+                          (end - begin) * job->width);
+}
+
+static size_t rows_grain(size_t width) {
+    return width >= ROWS_GRAIN_PIXELS ? 1 : ROWS_GRAIN_PIXELS / width;
+}
+
+void ycocg_r_from_rgb_rows(thread_pool *pool, const unsigned char *r, const unsigned char *g,
+                           const unsigned char *b, unsigned char *y, unsigned char *co, unsigned char *cg,
+                           size_t width, size_t height) {
+    if (width == 0)
+        return;
+    rows_job job = {.src = {r, g, b}, .dst = {y, co, cg}, .width = width};
+    parallel_for(pool, height, rows_grain(width), from_rgb_rows, &job);
+}
+
+void ycocg_r_to_rgb_rows(thread_pool *pool, const unsigned char *y, const unsigned char *co,
+                         const unsigned char *cg, unsigned char *r, unsigned char *g, unsigned char *b,
+                         size_t width, size_t height) {
+    if (width == 0)
+        return;
+    rows_job job = {.src = {y, co, cg}, .dst = {r, g, b}, .width = width};
+    parallel_for(pool, height, rows_grain(width), to_rgb_rows, &job);
+}
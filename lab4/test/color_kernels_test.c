@@ -0,0 +1,152 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../include/color_kernels.h"
+#include "../include/color_space.h"
+#include "../include/defines.h"
+
+#define COLOURS (1 << 24)
+// odd, so every call ends in a tail the vector loops don't cover
+#define CHUNK_PIXELS 4093
+#define PIXEL_SAMPLE_STEP 7
+
+typedef struct {
+    const char *name;
+    const affine_transform *affine;
+    void (*pixel)(unsigned char *s1, unsigned char *s2, unsigned char *s3);
+} linear_conversion;
+
+typedef struct {
+    const char *name;
+    affine_planes_func kernel;
+} kernel;
+
+static unsigned char *expected[3];
+static unsigned char *actual[3];
+
+static void fill_all_colours(unsigned char *planes[3]) {
+    for (size_t i = 0; i < COLOURS; ++i) {
+        planes[0][i] = i >> 16;
+        planes[1][i] = i >> 8;
+        planes[2][i] = i;
+    }
+}
+
+// the scalar kernel over every colour is the reference, a sample of colours ties it to the per-pixel function
+static int convert_reference(const linear_conversion *conv) {
+    fill_all_colours(expected);
+    affine_planes_scalar(conv->affine, expected[0], expected[1], expected[2], COLOURS);
+    for (size_t i = 0; i < COLOURS; i += PIXEL_SAMPLE_STEP) {
+        unsigned char s1 = i >> 16;
+        unsigned char s2 = i >> 8;
+        unsigned char s3 = i;
+        conv->pixel(&s1, &s2, &s3);
+        if (s1 != expected[0][i] || s2 != expected[1][i] || s3 != expected[2][i]) {
+            fprintf(stderr, "%s scalar: (%zu %zu %zu) differs from the per-pixel function\n", conv->name, i >> 16,
+                    (i >> 8) & 255, i & 255);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// every input colour through the kernel, in chunks that end in a tail the vector loops don't cover
+static int check_kernel(const linear_conversion *conv, const kernel *k) {
+    fill_all_colours(actual);
+    for (size_t i = 0; i < COLOURS; i += CHUNK_PIXELS) {
+        const size_t count = COLOURS - i < CHUNK_PIXELS ? COLOURS - i : CHUNK_PIXELS;
+        k->kernel(conv->affine, actual[0] + i, actual[1] + i, actual[2] + i, count);
+    }
+
+    for (size_t i = 0; i < COLOURS; ++i) {
+        if (expected[0][i] != actual[0][i] || expected[1][i] != actual[1][i] || expected[2][i] != actual[2][i]) {
+            fprintf(stderr, "%s %s: (%zu %zu %zu) gives (%d %d %d), expected (%d %d %d)\n", conv->name, k->name,
+                    i >> 16, (i >> 8) & 255, i & 255, actual[0][i], actual[1][i], actual[2][i], expected[0][i],
+                    expected[1][i], expected[2][i]);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int check_interleave(void) {
+    enum {
+        PIXELS = 1027
+    };
+    unsigned char packed[3 * PIXELS];
+    unsigned char expected[3][PIXELS];
+    unsigned char actual[3][PIXELS];
+    unsigned char repacked[3 * PIXELS];
+    for (size_t i = 0; i < sizeof(packed); ++i) {
+        packed[i] = (i * 7 + i / 5) & 255;
+    }
+
+    deinterleave_rgb_scalar(packed, expected[0], expected[1], expected[2], PIXELS);
+    deinterleave_rgb(packed, actual[0], actual[1], actual[2], PIXELS);
+    if (memcmp(expected, actual, sizeof(expected)) != 0) {
+        fprintf(stderr, "deinterleave_rgb differs from the scalar version\n");
+        return 1;
+    }
+    interleave_rgb(actual[0], actual[1], actual[2], repacked, PIXELS);
+    if (memcmp(packed, repacked, sizeof(packed)) != 0) {
+        fprintf(stderr, "interleave_rgb doesn't restore the packed pixels\n");
+        return 1;
+    }
+    return 0;
+}
+
+int main(void) {
+    const linear_conversion conversions[] = {
+            {"YCbCr_601 -> RGB", to_rgb_affine(YCbCr_601), YCbCr_601_to_rgb_pixel},
+            {"RGB -> YCbCr_601", from_rgb_affine(YCbCr_601), YCbCr_601_from_rgb_pixel},
+            {"YCbCr_709 -> RGB", to_rgb_affine(YCbCr_709), YCbCr_709_to_rgb_pixel},
+            {"RGB -> YCbCr_709", from_rgb_affine(YCbCr_709), YCbCr_709_from_rgb_pixel},
+            {"YCoCg -> RGB", to_rgb_affine(YCoCg), YCoCg_to_rgb_pixel},
+            {"RGB -> YCoCg", from_rgb_affine(YCoCg), YCoCg_from_rgb_pixel},
+            {"CMY -> RGB", to_rgb_affine(CMY), CMY_to_rgb_pixel},
+            {"RGB -> CMY", from_rgb_affine(CMY), CMY_from_rgb_pixel}
+    };
+
+    kernel kernels[2];
+    int kernel_count = 0;
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse2"))
+        kernels[kernel_count++] = (kernel) {"sse2", affine_planes_sse2};
+    if (__builtin_cpu_supports("avx2"))
+        kernels[kernel_count++] = (kernel) {"avx2", affine_planes_avx2};
+#endif
+
+    int failed = 0;
+    for (int i = 0; i < 3; ++i) {
+        expected[i] = malloc(COLOURS);
+        actual[i] = malloc(COLOURS);
+        if (!expected[i] || !actual[i]) {
+            fprintf(stderr, "no mem\n");
+            failed = 1;
+            goto cleanup;
+        }
+    }
+
+    failed = check_interleave();
+    for (size_t c = 0; c < sizeof(conversions) / sizeof(conversions[0]); ++c) {
+        if (convert_reference(&conversions[c]) != SUCCESS) {
+            ++failed;
+            continue;
+        }
+        for (int k = 0; k < kernel_count; ++k) {
+            failed += check_kernel(&conversions[c], &kernels[k]);
+        }
+    }
+
+    if (failed == 0)
+        printf("scalar and %d vector kernels bit-exact on all colours\n", kernel_count);
+
+    cleanup:
+    for (int i = 0; i < 3; ++i) {
+        free(actual[i]);
+        free(expected[i]);
+    }
+    return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
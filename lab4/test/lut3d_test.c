@@ -0,0 +1,149 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../include/lut3d.h"
+#include "../include/color_space.h"
+#include "../include/defines.h"
+
+// every third value per axis plus the borders, for the error bound off the grid
+#define SAMPLE_STEP 3
+
+typedef struct {
+    const char *name;
+    to_rgb_pixel_func to;
+    from_rgb_pixel_func from;
+    // largest allowed difference off the grid nodes, nonlinear conversions are not bounded
+    int tolerance;
+} lut_conversion;
+
+static const int sizes[] = {17, 33, 65};
+
+static int node_count(const lut3d *lut, int *nodes) {
+    int count = 0;
+    for (int v = 0; v < 256; ++v) {
+        if (lut->weight[v] == 0 || v == 255)
+            nodes[count++] = v;
+    }
+    return count;
+}
+
+static int difference(const unsigned char *a, const unsigned char *b) {
+    int worst = 0;
+    for (int k = 0; k < 3; ++k) {
+        const int d = abs(a[k] - b[k]);
+        worst = d > worst ? d : worst;
+    }
+    return worst;
+}
+
+static int apply_and_compare(const lut3d *lut, const lut_conversion *conv, int s1, int s2, int s3) {
+    unsigned char expected[3] = {s1, s2, s3};
+    conv->to(&expected[0], &expected[1], &expected[2]);
+    conv->from(&expected[0], &expected[1], &expected[2]);
+    unsigned char actual[3] = {s1, s2, s3};
+    lut3d_apply_planes(lut, &actual[0], &actual[1], &actual[2], 1);
+    return difference(expected, actual);
+}
+
+static int check_lut(const lut_conversion *conv, int size) {
+    lut3d lut;
+    if (lut3d_bake(&lut, size, conv->to, conv->from) != SUCCESS) {
+        fprintf(stderr, "%s %d: can't bake\n", conv->name, size);
+        return 1;
+    }
+
+    int failed = 0;
+    int nodes[256];
+    const int count = node_count(&lut, nodes);
+    if (count != size || nodes[0] != 0 || nodes[count - 1] != 255) {
+        fprintf(stderr, "%s %d: %d nodes from %d to %d\n", conv->name, size, count, nodes[0], nodes[count - 1]);
+        failed = 1;
+    }
+
+    // inputs on the grid, 0 and 255 on every axis among them, come straight from the baked conversion
+    for (int a = 0; a < count && !failed; ++a) {
+        for (int b = 0; b < count && !failed; ++b) {
+            for (int c = 0; c < count && !failed; ++c) {
+                if (apply_and_compare(&lut, conv, nodes[a], nodes[b], nodes[c]) != 0) {
+                    fprintf(stderr, "%s %d: node (%d %d %d) isn't exact\n", conv->name, size, nodes[a], nodes[b],
+                            nodes[c]);
+                    failed = 1;
+                }
+            }
+        }
+    }
+
+    for (int a = 0; a < 256 + SAMPLE_STEP && conv->tolerance >= 0 && !failed; a += SAMPLE_STEP) {
+        for (int b = 0; b < 256 + SAMPLE_STEP && !failed; b += SAMPLE_STEP) {
+            for (int c = 0; c < 256 + SAMPLE_STEP && !failed; c += SAMPLE_STEP) {
+                const int s1 = a > 255 ? 255 : a;
+                const int s2 = b > 255 ? 255 : b;
+                const int s3 = c > 255 ? 255 : c;
+                if (apply_and_compare(&lut, conv, s1, s2, s3) > conv->tolerance) {
+                    fprintf(stderr, "%s %d: (%d %d %d) is off by more than %d\n", conv->name, size, s1, s2, s3,
+                            conv->tolerance);
+                    failed = 1;
+                }
+            }
+        }
+    }
+
+    lut3d_free(&lut);
+    return failed;
+}
+
+// the cache header has a fixed byte order and a saved table comes back unchanged
+static int check_cache(const char *path) {
+    lut3d lut;
+    lut3d loaded = {};
+    if (lut3d_bake(&lut, 17, YCbCr_601_to_rgb_pixel, hsv_from_rgb_pixel) != SUCCESS)
+        return 1;
+
+    int failed = lut3d_save(&lut, path) != SUCCESS;
+    FILE *file = fopen(path, "rb");
+    unsigned char header[8];
+    const unsigned char expected[8] = {'L', 'U', 'T', '3', LUT3D_VERSION, 0, 17, 0};
+    if (file == NULL || fread(header, 1, sizeof(header), file) != sizeof(header) ||
+        memcmp(header, expected, sizeof(header)) != 0) {
+        fprintf(stderr, "unexpected cache header\n");
+        failed = 1;
+    }
+    if (file != NULL)
+        fclose(file);
+
+    if (!failed && (lut3d_load(&loaded, path) != SUCCESS || loaded.size != lut.size ||
+                    memcmp(loaded.data, lut.data, 17 * 17 * 17 * 3) != 0 ||
+                    memcmp(loaded.weight, lut.weight, sizeof(lut.weight)) != 0)) {
+        fprintf(stderr, "cached table doesn't load back\n");
+        failed = 1;
+    }
+
+    remove(path);
+    lut3d_free(&loaded);
+    lut3d_free(&lut);
+    return failed;
+}
+
+int main(int argc, char *argv[]) {
+    const lut_conversion conversions[] = {
+            {"RGB -> CMY", noop, CMY_from_rgb_pixel, 1},
+            {"RGB -> YCbCr_601", noop, YCbCr_601_from_rgb_pixel, 1},
+            {"RGB -> YCbCr_709", noop, YCbCr_709_from_rgb_pixel, 1},
+            {"RGB -> HSL", noop, hsl_from_rgb_pixel, -1},
+            {"HSV -> RGB", hsv_to_rgb_pixel, noop, -1},
+            {"YCbCr_601 -> HSV", YCbCr_601_to_rgb_pixel, hsv_from_rgb_pixel, -1}
+    };
+
+    int failed = 0;
+    for (size_t c = 0; c < sizeof(conversions) / sizeof(conversions[0]); ++c) {
+        for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s) {
+            failed += check_lut(&conversions[c], sizes[s]);
+        }
+    }
+    failed += check_cache(argc > 1 ? argv[1] : "lut3d_test.bin");
+
+    if (failed == 0)
+        printf("grid nodes exact, linear conversions within 1, cache round trip ok\n");
+    return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,17 @@
+#ifndef CLAHE_H
+#define CLAHE_H
+
+#include <stddef.h>
+
+#include "thread_pool.h"
+
+#define CLAHE_MAX_TILES 64
+
+// contrast-limited adaptive histogram equalisation of gray samples (channels 1) or of the YCbCr.601 luma of
+// packed rgb pixels (channels 3). the picture is split into tiles x tiles parts, each gets its own equalising
+// mapping with bins clipped at clip times the mean bin count, and every sample blends the mappings of the four
+// nearest tile centres
+int clahe_apply(thread_pool *pool, unsigned char *data, size_t width, size_t height, int channels, int tiles,
+                float clip);
+
+#endif
@@ -39,6 +39,9 @@ void hsv_from_rgb_pixel(unsigned char *s1, unsigned char *s2, unsigned char *s3)
 
 void YCbCr_601_from_rgb_pixel(unsigned char *s1, unsigned char *s2, unsigned char *s3);
 
+// Y of YCbCr_601_from_rgb_pixel alone, rgb is a packed pixel
+unsigned char YCbCr_601_luma(const unsigned char *rgb);
+
 void YCbCr_709_from_rgb_pixel(unsigned char *s1, unsigned char *s2, unsigned char *s3);
 
 void YCoCg_from_rgb_pixel(unsigned char *s1, unsigned char *s2, unsigned char *s3);
@@ -0,0 +1,55 @@
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <stddef.h>
+
+#include "thread_pool.h"
+
+#define HISTOGRAM_BINS 256
+
+typedef struct {
+    size_t count[HISTOGRAM_BINS];
+    size_t total;
+} histogram;
+
+// counts every byte of data
+void histogram_build(thread_pool *pool, histogram *hist, const unsigned char *data, size_t count);
+
+// counts the YCbCr.601 luma of packed rgb pixels without converting them
+void histogram_build_YCbCr601(thread_pool *pool, histogram *hist, const unsigned char *pixels, size_t count);
+
+// one histogram per channel of packed rgb pixels, hists points to three of them
+void histogram_build_rgb(thread_pool *pool, histogram *hists, const unsigned char *pixels, size_t count);
+
+// counts only every step-th row, starting in the middle of the first step;
+// row_size and width are in samples and pixels
+void histogram_build_rows(thread_pool *pool, histogram *hist, const unsigned char *data, size_t row_size,
+                          size_t height, size_t step);
+
+void histogram_build_YCbCr601_rows(thread_pool *pool, histogram *hist, const unsigned char *pixels, size_t width,
+                                   size_t height, size_t step);
+
+// darkest and brightest present values, 255 and 0 for an empty histogram
+void histogram_min_max(const histogram *hist, unsigned char *min, unsigned char *max);
+
+// the same after dropping up to skip samples from each end
+void histogram_min_max_with_skip(const histogram *hist, size_t skip, unsigned char *min, unsigned char *max);
+
+double histogram_mean(const histogram *hist);
+
+typedef struct {
+    unsigned char min;
+    unsigned char max;
+    // the exact cut values lie within these at the requested confidence
+    unsigned char min_low;
+    unsigned char min_high;
+    unsigned char max_low;
+    unsigned char max_high;
+    // z standard errors of the cut quantile, as a share of the samples
+    double bound;
+} histogram_cut_estimate;
+
+// estimates from a sampled histogram where histogram_min_max_with_skip would cut fraction of the samples
+void histogram_estimate_cut(const histogram *sample, double fraction, double z, histogram_cut_estimate *estimate);
+
+#endif
@@ -0,0 +1,60 @@
+#ifndef LEVELS_H
+#define LEVELS_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "thread_pool.h"
+#include "histogram.h"
+
+#define LEVELS_LUT_SIZE 256
+
+typedef void (*levels_apply_func)(const unsigned char *lut, unsigned char *data, size_t count);
+
+// (X - offset) * factor for every possible byte, clamped to [0, 255]
+void levels_lut_manual(unsigned char *lut, long offset, float factor);
+
+// stretches [min, max] to [0, 255], a flat range keeps every value
+void levels_lut_auto(unsigned char *lut, unsigned char min, unsigned char max);
+
+// spreads the cumulative share of every value over [0, 255], the darkest present value goes to 0
+void levels_lut_equalise(unsigned char *lut, const histogram *hist);
+
+// gives every value the smallest reference value whose cumulative share is at least its own
+void levels_lut_match(unsigned char *lut, const histogram *source, const histogram *reference);
+
+// exponentially smoothed auto levels over a sequence of frames
+typedef struct {
+    // weight of the newest frame, 1 disables smoothing
+    double alpha;
+    bool started;
+    double min;
+    double max;
+} levels_smoothing;
+
+// folds the [min, max] range of a frame into the running range and returns the offset and factor stretching it,
+// a flat frame leaves the range as it was
+void levels_smoothing_update(levels_smoothing *smoothing, unsigned char min, unsigned char max, long *offset,
+                             float *factor);
+
+void levels_apply_scalar(const unsigned char *lut, unsigned char *data, size_t count);
+
+// pshufb over the 16 nibble rows of the table, so no gather is needed
+void levels_apply_avx2(const unsigned char *lut, unsigned char *data, size_t count);
+
+// avx2 if the running cpu has it, else the scalar lookups
+levels_apply_func levels_apply_kernel(void);
+
+// maps every byte of data through lut
+void levels_apply(thread_pool *pool, const unsigned char *lut, unsigned char *data, size_t count);
+
+// maps each channel of packed rgb pixels through its own table, luts holds the three one after another
+void levels_apply_rgb(thread_pool *pool, const unsigned char *luts, unsigned char *pixels, size_t count);
+
+// changes the YCbCr.601 luma of a packed rgb pixel by delta, keeping cb and cr
+void levels_shift_YCbCr601(unsigned char *rgb, int delta);
+
+// maps only the YCbCr.601 luma of packed rgb pixels, the change is applied in rgb without converting them
+void levels_apply_YCbCr601(thread_pool *pool, const unsigned char *lut, unsigned char *pixels, size_t count);
+
+#endif
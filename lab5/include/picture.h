@@ -35,6 +35,9 @@ int read_header(const char *data, size_t data_size, enum type *type, size_t *wid
 
 int save_picture(struct picture *picture, FILE *out);
 
+// reads a whole P5 or P6 file, prints the reason on failure
+picture *load_picture(FILE *file);
+
 void line_from_to(picture *pic, point pf, point pt, unsigned char brightness, double gamma, double wd);
 
 int picture_to_dpicture(picture *src, dpicture *out);
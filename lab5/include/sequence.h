@@ -0,0 +1,50 @@
+#ifndef SEQUENCE_H
+#define SEQUENCE_H
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#include "picture.h"
+
+// frames come either from numbered files, named by a printf pattern with one %d conversion and counted from
+// 0 or 1, or from one file of concatenated P5/P6 pictures
+typedef struct {
+    const char *pattern;
+    FILE *stream;
+    int number;
+} frame_source;
+
+typedef frame_source frame_sink;
+
+bool frame_pattern_valid(const char *name);
+
+int frame_source_open(frame_source *source, const char *name);
+
+// *frame is NULL once the frames are over
+int frame_source_next(frame_source *source, picture **frame);
+
+void frame_source_close(frame_source *source);
+
+// numbered sinks use the same numbers as the source
+int frame_sink_open(frame_sink *sink, const char *name, const frame_source *source);
+
+int frame_sink_write(frame_sink *sink, picture *frame);
+
+int frame_sink_close(frame_sink *sink);
+
+// reads the next frame on its own thread while the current one is processed
+typedef struct {
+    frame_source *source;
+    pthread_t thread;
+    bool threaded;
+    picture *frame;
+    int status;
+} frame_prefetch;
+
+// falls back to reading in place if no thread can be started
+void frame_prefetch_start(frame_prefetch *prefetch, frame_source *source);
+
+int frame_prefetch_finish(frame_prefetch *prefetch, picture **frame);
+
+#endif
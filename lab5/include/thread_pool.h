@@ -0,0 +1,23 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <stddef.h>
+
+typedef struct thread_pool thread_pool;
+
+typedef void (*parallel_for_func)(void *context, size_t begin, size_t end);
+
+int default_thread_count(void);
+
+// threads counts the calling thread too, so 1 runs everything inline
+thread_pool *thread_pool_create(int threads);
+
+void thread_pool_destroy(thread_pool *pool);
+
+int thread_pool_threads(const thread_pool *pool);
+
+// splits [0, count) into chunks of grain items and returns once all of them are done;
+// only one parallel_for may run on a pool at a time
+void parallel_for(thread_pool *pool, size_t count, size_t grain, parallel_for_func func, void *context);
+
+#endif
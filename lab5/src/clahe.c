@@ -0,0 +1,191 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#include "../include/clahe.h"
+#include "../include/color_space.h"
+#include "../include/levels.h"
+#include "../include/thread_pool.h"
+#include "../include/defines.h"
+
+#define CLAHE_BINS 256
+#define ROWS_GRAIN_PIXELS 65536
+
+// where one column (or row) sits in the tile grid
+typedef struct {
+    size_t tile;
+    // tiles whose centres surround the sample, equal near the borders
+    size_t low;
+    size_t high;
+    float weight;
+} clahe_axis;
+
+typedef struct {
+    unsigned char *data;
+    size_t width;
+    int channels;
+    size_t tiles_x;
+    const size_t *row_starts;
+    const clahe_axis *columns;
+    const clahe_axis *rows;
+    uint32_t *counts;
+    const unsigned char *luts;
+} clahe_job;
+
+static size_t tile_start(size_t i, size_t size, size_t tiles) {
+    return i * size / tiles;
+}
+
+static float tile_centre(size_t i, size_t size, size_t tiles) {
+    return (float) (tile_start(i, size, tiles) + tile_start(i + 1, size, tiles) - 1) / 2.f;
+}
+
+static void fill_axis(clahe_axis *axis, size_t size, size_t tiles) {
+    size_t tile = 0;
+    size_t low = 0;
+    for (size_t x = 0; x < size; ++x) {
+        while (tile + 1 < tiles && tile_start(tile + 1, size, tiles) <= x) {
+            ++tile;
+        }
+        while (low + 1 < tiles && tile_centre(low + 1, size, tiles) <= (float) x) {
+            ++low;
+        }
+
+        axis[x].tile = tile;
+        axis[x].low = low;
+        if ((float) x <= tile_centre(0, size, tiles) || low + 1 == tiles) {
+            axis[x].high = low;
+            axis[x].weight = 0.f;
+        } else {
+            const float left = tile_centre(low, size, tiles);
+            axis[x].high = low + 1;
+            axis[x].weight = ((float) x - left) / (tile_centre(low + 1, size, tiles) - left);
+        }
+    }
+}
+
+static unsigned char sample(const clahe_job *job, size_t offset) {
+    return job->channels == 1 ? job->data[offset] : YCbCr_601_luma(job->data + 3 * offset);
+}
+
+// begin and end index tile rows, so every tile is counted by one chunk only
+static void count_tiles(void *context, size_t begin, size_t end) {
+    const clahe_job *job = context;
+    for (size_t y = job->row_starts[begin]; y < job->row_starts[end]; ++y) {
+        uint32_t *row_counts = job->counts + job->rows[y].tile * job->tiles_x * CLAHE_BINS;
+        for (size_t x = 0; x < job->width; ++x) {
+            ++row_counts[job->columns[x].tile * CLAHE_BINS + sample(job, y * job->width + x)];
+        }
+    }
+}
+
+// clipped counts are spread evenly over all bins, then the cumulative share maps to [0, 255]
+static void build_lut(uint32_t *counts, size_t pixels, float clip, unsigned char *lut) {
+    const float limit_f = clip * (float) pixels / CLAHE_BINS;
+    const uint32_t limit = limit_f < 1.f ? 1 : (uint32_t) limit_f;
+    size_t excess = 0;
+    for (int i = 0; i < CLAHE_BINS; ++i) {
+        if (counts[i] > limit) {
+            excess += counts[i] - limit;
+            counts[i] = limit;
+        }
+    }
+
+    const uint32_t share = excess / CLAHE_BINS;
+    const size_t rest = excess % CLAHE_BINS;
+    for (int i = 0; i < CLAHE_BINS; ++i) {
+        counts[i] += share;
+    }
+    for (size_t i = 0; i < rest; ++i) {
+        ++counts[i * CLAHE_BINS / rest];
+    }
+
+    size_t cdf = 0;
+    for (int i = 0; i < CLAHE_BINS; ++i) {
+        cdf += counts[i];
+        lut[i] = (cdf * 255 + pixels / 2) / pixels;
+    }
+}
+
+static void blend_rows(void *context, size_t begin, size_t end) {
+    const clahe_job *job = context;
+    for (size_t y = begin; y < end; ++y) {
+        const clahe_axis row = job->rows[y];
+        const unsigned char *top = job->luts + row.low * job->tiles_x * CLAHE_BINS;
+        const unsigned char *bottom = job->luts + row.high * job->tiles_x * CLAHE_BINS;
+        for (size_t x = 0; x < job->width; ++x) {
+            const clahe_axis column = job->columns[x];
+            const size_t offset = y * job->width + x;
+            const unsigned char v = sample(job, offset);
+            const size_t left = column.low * CLAHE_BINS + v;
+            const size_t right = column.high * CLAHE_BINS + v;
+
+            const float upper = top[left] + column.weight * (float) (top[right] - top[left]);
+            const float lower = bottom[left] + column.weight * (float) (bottom[right] - bottom[left]);
+            const unsigned char mapped = lrintf(upper + row.weight * (lower - upper));
+
+            if (job->channels == 1)
+                job->data[offset] = mapped;
+            else
+                levels_shift_YCbCr601(job->data + 3 * offset, mapped - v);
+        }
+    }
+}
+
+int clahe_apply(thread_pool *pool, unsigned char *data, size_t width, size_t height, int channels, int tiles,
+                float clip) {
+    if (width == 0 || height == 0)
+        return SUCCESS;
+
+    const size_t tiles_x = (size_t) tiles < width ? (size_t) tiles : width;
+    const size_t tiles_y = (size_t) tiles < height ? (size_t) tiles : height;
+    int ret = NOMEM;
+
+    clahe_axis *columns = malloc(width * sizeof(clahe_axis));
+    clahe_axis *rows = malloc(height * sizeof(clahe_axis));
+    size_t *row_starts = malloc((tiles_y + 1) * sizeof(size_t));
+    uint32_t *counts = calloc(tiles_x * tiles_y * CLAHE_BINS, sizeof(uint32_t));
+    unsigned char *luts = malloc(tiles_x * tiles_y * CLAHE_BINS);
+    if (!columns || !rows || !row_starts || !counts || !luts)
+        goto cleanup;
+
+    fill_axis(columns, width, tiles_x);
+    fill_axis(rows, height, tiles_y);
+    for (size_t i = 0; i <= tiles_y; ++i) {
+        row_starts[i] = tile_start(i, height, tiles_y);
+    }
+
+    clahe_job job = {
+            .data = data,
+            .width = width,
+            .channels = channels,
+            .tiles_x = tiles_x,
+            .row_starts = row_starts,
+            .columns = columns,
+            .rows = rows,
+            .counts = counts,
+            .luts = luts
+    };
+    parallel_for(pool, tiles_y, 1, count_tiles, &job);
+
+    for (size_t ty = 0; ty < tiles_y; ++ty) {
+        for (size_t tx = 0; tx < tiles_x; ++tx) {
+            const size_t pixels = (row_starts[ty + 1] - row_starts[ty]) *
+                                  (tile_start(tx + 1, width, tiles_x) - tile_start(tx, width, tiles_x));
+            const size_t tile = ty * tiles_x + tx;
+            build_lut(counts + tile * CLAHE_BINS, pixels, clip, luts + tile * CLAHE_BINS);
+        }
+    }
+
+    parallel_for(pool, height, width >= ROWS_GRAIN_PIXELS ? 1 : ROWS_GRAIN_PIXELS / width, blend_rows, &job);
+    ret = SUCCESS;
+
+    cleanup:
+    free(luts);
+    free(counts);
+    free(row_starts);
+    free(rows);
+    free(columns);
+    return ret;
+}
@@ -196,6 +196,11 @@ void YCbCr_601_from_rgb_pixel(unsigned char *s1, unsigned char *s2, unsigned cha
     *s3 = round(fminf(fmaxf(cr, 0.f), 255.f));
 }
 
+// the coefficients are exact thousandths, so rounding the integer sum gives the same byte for every colour
+unsigned char YCbCr_601_luma(const unsigned char *rgb) {
+    return (299u * rgb[0] + 587u * rgb[1] + 114u * rgb[2] + 500u) / 1000u;
+}
+
 void YCbCr_709_from_rgb_pixel(unsigned char *s1, unsigned char *s2, unsigned char *s3) {
     const float r = *s1;
     const float g = *s2;
@@ -0,0 +1,291 @@
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <math.h>
+#include <pthread.h>
+
+#include "../include/histogram.h"
+#include "../include/color_space.h"
+#include "../include/thread_pool.h"
+
+#define HISTOGRAM_GRAIN_BYTES 262144
+#define HISTOGRAM_GRAIN_PIXELS 65536
+#define HISTOGRAM_BANKS 4
+
+typedef uint32_t histogram_banks[HISTOGRAM_BANKS][HISTOGRAM_BINS];
+
+typedef void (*count_span_func)(histogram_banks banks, const unsigned char *data, size_t count);
+
+// a bin of a bank takes at most grain samples between flushes, far below 2^32
+typedef struct {
+    histogram_banks banks;
+    // samples in the banks since the last flush
+    size_t pending;
+    histogram hist;
+} bank_counter;
+
+typedef struct {
+    histogram *hist;
+    const unsigned char *data;
+    count_span_func span;
+    size_t sample_size;
+    size_t grain;
+    // sampled rows only
+    size_t row_size;
+    size_t first;
+    size_t step;
+    pthread_mutex_t mutex;
+} histogram_job;
+
+// neighbouring samples go to different banks so runs of equal values don't wait on each other's stores
+static void count_bytes(histogram_banks banks, const unsigned char *data, size_t count) {
+    size_t i = 0;
+    for (; i + HISTOGRAM_BANKS <= count; i += HISTOGRAM_BANKS) {
+        ++banks[0][data[i]];
+        ++banks[1][data[i + 1]];
+        ++banks[2][data[i + 2]];
+        ++banks[3][data[i + 3]];
+    }
+    for (; i < count; ++i) {
+        ++banks[0][data[i]];
+    }
+}
+
+static void count_YCbCr601(histogram_banks banks, const unsigned char *pixels, size_t count) {
+    size_t i = 0;
+    for (; i + HISTOGRAM_BANKS <= count; i += HISTOGRAM_BANKS) {
+        ++banks[0][YCbCr_601_luma(pixels + 3 * i)];
+        ++banks[1][YCbCr_601_luma(pixels + 3 * i + 3)];
+        ++banks[2][YCbCr_601_luma(pixels + 3 * i + 6)];
+        ++banks[3][YCbCr_601_luma(pixels + 3 * i + 9)];
+    }
+    for (; i < count; ++i) {
+        ++banks[0][YCbCr_601_luma(pixels + 3 * i)];
+    }
+}
+
+static void flush_banks(bank_counter *counter) {
+    for (int i = 0; i < HISTOGRAM_BINS; ++i) {
+        counter->hist.count[i] += (size_t) counter->banks[0][i] + counter->banks[1][i] + counter->banks[2][i] +
+                                  counter->banks[3][i];
+    }
+    counter->hist.total += counter->pending;
+    counter->pending = 0;
+    memset(counter->banks, 0, sizeof(counter->banks));
+}
+
+// counts in pieces that never put more than grain samples into the banks, however long the span is
+static void count_span(const histogram_job *job, bank_counter *counter, const unsigned char *data, size_t count) {
+    while (count > 0) {
+        if (counter->pending >= job->grain)
+            flush_banks(counter);
+        const size_t piece = count < job->grain - counter->pending ? count : job->grain - counter->pending;
+        job->span(counter->banks, data, piece);
+        counter->pending += piece;
+        data += piece * job->sample_size;
+        count -= piece;
+    }
+}
+
+static void merge_counter(histogram_job *job, histogram *hist, bank_counter *counter) {
+    flush_banks(counter);
+    pthread_mutex_lock(&job->mutex);
+    for (int i = 0; i < HISTOGRAM_BINS; ++i) {
+        hist->count[i] += counter->hist.count[i];
+    }
+    hist->total += counter->hist.total;
+    pthread_mutex_unlock(&job->mutex);
+}
+
+static void count_range(void *context, size_t begin, size_t end) {
+    histogram_job *job = context;
+    bank_counter counter;
+    memset(&counter, 0, sizeof(counter));
+    count_span(job, &counter, job->data + begin * job->sample_size, end - begin);
+    merge_counter(job, job->hist, &counter);
+}
+
+// begin and end index the sampled rows
+static void count_rows(void *context, size_t begin, size_t end) {
+    histogram_job *job = context;
+    bank_counter counter;
+    memset(&counter, 0, sizeof(counter));
+    for (size_t i = begin; i < end; ++i) {
+        const size_t row = job->first + i * job->step;
+        count_span(job, &counter, job->data + row * job->row_size * job->sample_size, job->row_size);
+    }
+    merge_counter(job, job->hist, &counter);
+}
+
+static void build(thread_pool *pool, histogram *hist, histogram_job *job, size_t count, size_t grain,
+                  parallel_for_func func) {
+    memset(hist, 0, sizeof(*hist));
+    job->hist = hist;
+    pthread_mutex_init(&job->mutex, NULL);
+    parallel_for(pool, count, grain, func, job);
+    pthread_mutex_destroy(&job->mutex);
+}
+
+void histogram_build(thread_pool *pool, histogram *hist, const unsigned char *data, size_t count) {
+    histogram_job job = {.data = data, .span = count_bytes, .sample_size = 1, .grain = HISTOGRAM_GRAIN_BYTES};
+    build(pool, hist, &job, count, HISTOGRAM_GRAIN_BYTES, count_range);
+}
+
+void histogram_build_YCbCr601(thread_pool *pool, histogram *hist, const unsigned char *pixels, size_t count) {
+    histogram_job job = {.data = pixels, .span = count_YCbCr601, .sample_size = 3,
+                         .grain = HISTOGRAM_GRAIN_PIXELS};
+    build(pool, hist, &job, count, HISTOGRAM_GRAIN_PIXELS, count_range);
+}
+
+// interleaved rgb, every channel keeps its own banks
+static void count_rgb_span(bank_counter counters[3], const unsigned char *pixels, size_t count) {
+    size_t i = 0;
+    for (; i + HISTOGRAM_BANKS <= count; i += HISTOGRAM_BANKS) {
+        for (int k = 0; k < HISTOGRAM_BANKS; ++k) {
+            const unsigned char *c = pixels + 3 * (i + k);
+            ++counters[0].banks[k][c[0]];
+            ++counters[1].banks[k][c[1]];
+            ++counters[2].banks[k][c[2]];
+        }
+    }
+    for (; i < count; ++i) {
+        const unsigned char *c = pixels + 3 * i;
+        ++counters[0].banks[0][c[0]];
+        ++counters[1].banks[0][c[1]];
+        ++counters[2].banks[0][c[2]];
+    }
+    for (int k = 0; k < 3; ++k) {
+        counters[k].pending += count;
+    }
+}
+
+static void count_rgb(void *context, size_t begin, size_t end) {
+    histogram_job *job = context;
+    bank_counter counters[3];
+    memset(counters, 0, sizeof(counters));
+
+    for (size_t i = begin; i < end; i += job->grain) {
+        const size_t piece = end - i < job->grain ? end - i : job->grain;
+        count_rgb_span(counters, job->data + 3 * i, piece);
+        for (int k = 0; k < 3; ++k) {
+            flush_banks(&counters[k]);
+        }
+    }
+
+    for (int k = 0; k < 3; ++k) {
+        merge_counter(job, job->hist + k, &counters[k]);
+    }
+}
+
+void histogram_build_rgb(thread_pool *pool, histogram *hists, const unsigned char *pixels, size_t count) {
+    memset(hists, 0, 3 * sizeof(histogram));
+    histogram_job job = {.hist = hists, .data = pixels, .grain = HISTOGRAM_GRAIN_PIXELS};
+    pthread_mutex_init(&job.mutex, NULL);
+    parallel_for(pool, count, HISTOGRAM_GRAIN_PIXELS, count_rgb, &job);
+    pthread_mutex_destroy(&job.mutex);
+}
+
+static size_t sampled_rows(size_t height, size_t step) {
+    const size_t first = step / 2;
+    return first < height ? (height - first - 1) / step + 1 : 0;
+}
+
+static void build_rows(thread_pool *pool, histogram *hist, histogram_job *job, size_t height, size_t step,
+                       size_t grain) {
+    job->first = step / 2;
+    job->step = step;
+    const size_t rows = sampled_rows(height, step);
+    const size_t rows_grain = job->row_size >= grain ? 1 : grain / job->row_size;
+    build(pool, hist, job, job->row_size == 0 ? 0 : rows, rows_grain, count_rows);
+}
+
+void histogram_build_rows(thread_pool *pool, histogram *hist, const unsigned char *data, size_t row_size,
+                          size_t height, size_t step) {
+    histogram_job job = {.data = data, .span = count_bytes, .sample_size = 1, .grain = HISTOGRAM_GRAIN_BYTES,
+                         .row_size = row_size};
+    build_rows(pool, hist, &job, height, step, HISTOGRAM_GRAIN_BYTES);
+}
+
+void histogram_build_YCbCr601_rows(thread_pool *pool, histogram *hist, const unsigned char *pixels, size_t width,
+                                   size_t height, size_t step) {
+    histogram_job job = {.data = pixels, .span = count_YCbCr601, .sample_size = 3,
+                         .grain = HISTOGRAM_GRAIN_PIXELS, .row_size = width};
+    build_rows(pool, hist, &job, height, step, HISTOGRAM_GRAIN_PIXELS);
+}
+
+void histogram_min_max(const histogram *hist, unsigned char *min, unsigned char *max) {
+    *min = 255;
+    *max = 0;
+    for (int i = 0; i < HISTOGRAM_BINS; ++i) {
+        if (hist->count[i] != 0) {
+            *min = i;
+            break;
+        }
+    }
+    for (int i = HISTOGRAM_BINS - 1; i >= 0; --i) {
+        if (hist->count[i] != 0) {
+            *max = i;
+            break;
+        }
+    }
+}
+
+void histogram_min_max_with_skip(const histogram *hist, size_t skip, unsigned char *min, unsigned char *max) {
+    *min = 255;
+    *max = 0;
+
+    size_t count = 0;
+    for (int i = 0; i < HISTOGRAM_BINS; ++i) {
+        if (count + hist->count[i] < skip) {
+            count += hist->count[i];
+        } else {
+            *min = i;
+            break;
+        }
+    }
+
+    count = 0;
+
+    for (int i = HISTOGRAM_BINS - 1; i >= 0; --i) {
+        if (count + hist->count[i] < skip) {
+            count += hist->count[i];
+        } else {
+            *max = i;
+            break;
+        }
+    }
+}
+
+// value holding the sample of rank fraction * total counted from the dark end, or from the bright one
+static unsigned char cut_bin(const histogram *hist, double fraction, bool bright) {
+    size_t count = 0;
+    for (int j = 0; j < HISTOGRAM_BINS; ++j) {
+        const int i = bright ? HISTOGRAM_BINS - 1 - j : j;
+        count += hist->count[i];
+        if ((double) count >= fraction * (double) hist->total)
+            return i;
+    }
+    return bright ? 0 : HISTOGRAM_BINS - 1;
+}
+
+void histogram_estimate_cut(const histogram *sample, double fraction, double z, histogram_cut_estimate *estimate) {
+    // binomial error of an empirical quantile, nominal because samples from one row are correlated
+    estimate->bound = sample->total == 0 ? 0. : z * sqrt(fraction * (1. - fraction) / (double) sample->total);
+
+    estimate->min = cut_bin(sample, fraction, false);
+    estimate->min_low = cut_bin(sample, fraction - estimate->bound, false);
+    estimate->min_high = cut_bin(sample, fraction + estimate->bound, false);
+    estimate->max = cut_bin(sample, fraction, true);
+    estimate->max_low = cut_bin(sample, fraction + estimate->bound, true);
+    estimate->max_high = cut_bin(sample, fraction - estimate->bound, true);
+}
+
+double histogram_mean(const histogram *hist) {
+    if (hist->total == 0)
+        return 0.;
+    double sum = 0.;
+    for (int i = 0; i < HISTOGRAM_BINS; ++i) {
+        sum += (double) i * (double) hist->count[i];
+    }
+    return sum / (double) hist->total;
+}
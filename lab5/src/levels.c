@@ -0,0 +1,215 @@
+#include <math.h>
+
+#include "../include/levels.h"
+#include "../include/color_space.h"
+#include "../include/thread_pool.h"
+#include "../include/histogram.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define X86_KERNELS 1
+#include <immintrin.h>
+#endif
+
+#define APPLY_GRAIN_BYTES 262144
+#define APPLY_GRAIN_PIXELS 65536
+
+static unsigned char do_correction(unsigned char val, long offset, float factor) {
+    return round(fmaxf(0.f, fminf(255.f, fmaxf(0.f, (float) (val - offset)) * factor)));
+}
+
+static unsigned char auto_correction(unsigned char val, int min_val, unsigned char max_val) {
+    return round(fmaxf(0.f, fminf(255.f, fmaxf(0.f, (float) (val - min_val)) * 255.f / (float) (max_val - min_val))));
+}
+
+static void lut_identity(unsigned char *lut) {
+    for (int i = 0; i < LEVELS_LUT_SIZE; ++i) {
+        lut[i] = i;
+    }
+}
+
+void levels_lut_manual(unsigned char *lut, long offset, float factor) {
+    for (int i = 0; i < LEVELS_LUT_SIZE; ++i) {
+        lut[i] = do_correction(i, offset, factor);
+    }
+}
+
+void levels_lut_auto(unsigned char *lut, unsigned char min, unsigned char max) {
+    // nothing to stretch in a flat range
+    if (max <= min) {
+        lut_identity(lut);
+        return;
+    }
+    for (int i = 0; i < LEVELS_LUT_SIZE; ++i) {
+        lut[i] = auto_correction(i, min, max);
+    }
+}
+
+void levels_lut_equalise(unsigned char *lut, const histogram *hist) {
+    size_t first = 0;
+    for (int i = 0; i < HISTOGRAM_BINS && first == 0; ++i) {
+        first = hist->count[i];
+    }
+    // nothing to spread for a single value
+    if (hist->total == first) {
+        lut_identity(lut);
+        return;
+    }
+
+    const size_t range = hist->total - first;
+    size_t cdf = 0;
+    for (int i = 0; i < LEVELS_LUT_SIZE; ++i) {
+        cdf += hist->count[i];
+        lut[i] = cdf < first ? 0 : ((cdf - first) * 255 + range / 2) / range;
+    }
+}
+
+void levels_lut_match(unsigned char *lut, const histogram *source, const histogram *reference) {
+    if (source->total == 0 || reference->total == 0) {
+        lut_identity(lut);
+        return;
+    }
+
+    size_t source_cdf = 0;
+    size_t reference_cdf = reference->count[0];
+    int value = 0;
+    for (int i = 0; i < LEVELS_LUT_SIZE; ++i) {
+        source_cdf += source->count[i];
+        const double share = (double) source_cdf / (double) source->total;
+        while (value < HISTOGRAM_BINS - 1 && (double) reference_cdf / (double) reference->total < share) {
+            reference_cdf += reference->count[++value];
+        }
+        lut[i] = value;
+    }
+}
+
+void levels_smoothing_update(levels_smoothing *smoothing, unsigned char min, unsigned char max, long *offset,
+                             float *factor) {
+    // a flat frame has no range to stretch, so it keeps the previous one, or the identity before any other frame
+    if (max > min) {
+        if (!smoothing->started) {
+            smoothing->started = true;
+            smoothing->min = min;
+            smoothing->max = max;
+        } else {
+            smoothing->min += smoothing->alpha * (min - smoothing->min);
+            smoothing->max += smoothing->alpha * (max - smoothing->max);
+        }
+    }
+    if (!smoothing->started) {
+        *offset = 0;
+        *factor = 1.f;
+        return;
+    }
+    // the running bounds mix ranges with max > min, so the difference stays positive
+    *offset = lround(smoothing->min);
+    *factor = 255. / (smoothing->max - smoothing->min);
+}
+
+void levels_apply_scalar(const unsigned char *lut, unsigned char *data, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        data[i] = lut[data[i]];
+    }
+}
+
+#ifdef X86_KERNELS
+
+// row h of the table answers bytes 16h..16h+15: after subtracting 16h only those land in [0, 15],
+// and the saturating add pushes every other byte past 0x7f so pshufb zeroes it.
+// the 128-bit version of this loses to plain table lookups, so only avx2 gets one
+__attribute__((target("avx2")))
+void levels_apply_avx2(const unsigned char *lut, unsigned char *data, size_t count) {
+    __m256i rows[16];
+    for (int h = 0; h < 16; ++h) {
+        rows[h] = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *) (lut + 16 * h)));
+    }
+    const __m256i bias = _mm256_set1_epi8(0x70);
+    const __m256i step = _mm256_set1_epi8(16);
+
+    size_t i = 0;
+    for (; i + 32 <= count; i += 32) {
+        __m256i t = _mm256_loadu_si256((const __m256i *) (data + i));
+        __m256i r = _mm256_setzero_si256();
+        for (int h = 0; h < 16; ++h) {
+            r = _mm256_or_si256(r, _mm256_shuffle_epi8(rows[h], _mm256_adds_epu8(t, bias)));
+            t = _mm256_sub_epi8(t, step);
+        }
+        _mm256_storeu_si256((__m256i *) (data + i), r);
+    }
+    levels_apply_scalar(lut, data + i, count - i);
+}
+
+levels_apply_func levels_apply_kernel(void) {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return levels_apply_avx2;
+    }
+    return levels_apply_scalar;
+}
+
+#else
+
+void levels_apply_avx2(const unsigned char *lut, unsigned char *data, size_t count) {
+    levels_apply_scalar(lut, data, count);
+}
+
+levels_apply_func levels_apply_kernel(void) {
+    return levels_apply_scalar;
+}
+
+#endif
+
+typedef struct {
+    const unsigned char *lut;
+    unsigned char *data;
+    levels_apply_func kernel;
+} apply_job;
+
+static void apply_bytes(void *context, size_t begin, size_t end) {
+    const apply_job *job = context;
+    job->kernel(job->lut, job->data + begin, end - begin);
+}
+
+static void apply_rgb_pixels(void *context, size_t begin, size_t end) {
+    const apply_job *job = context;
+    const unsigned char *r = job->lut;
+    const unsigned char *g = job->lut + LEVELS_LUT_SIZE;
+    const unsigned char *b = job->lut + 2 * LEVELS_LUT_SIZE;
+    for (size_t i = begin; i < end; ++i) {
+        unsigned char *c = job->data + 3 * i;
+        c[0] = r[c[0]];
+        c[1] = g[c[1]];
+        c[2] = b[c[2]];
+    }
+}
+
+// with cb and cr unchanged the inverse 601 matrix turns a change of y into the same change of r, g and b
+void levels_shift_YCbCr601(unsigned char *rgb, int delta) {
+    for (int k = 0; k < 3; ++k) {
+        const int v = rgb[k] + delta;
+        rgb[k] = v < 0 ? 0 : v > 255 ? 255 : v;
+    }
+}
+
+static void apply_YCbCr601_pixels(void *context, size_t begin, size_t end) {
+    const apply_job *job = context;
+    for (size_t i = begin; i < end; ++i) {
+        unsigned char *c = job->data + 3 * i;
+        const int y = YCbCr_601_luma(c);
+        levels_shift_YCbCr601(c, job->lut[y] - y);
+    }
+}
+
+void levels_apply(thread_pool *pool, const unsigned char *lut, unsigned char *data, size_t count) {
+    apply_job job = {.lut = lut, .data = data, .kernel = levels_apply_kernel()};
+    parallel_for(pool, count, APPLY_GRAIN_BYTES, apply_bytes, &job);
+}
+
+void levels_apply_rgb(thread_pool *pool, const unsigned char *luts, unsigned char *pixels, size_t count) {
+    apply_job job = {.lut = luts, .data = pixels};
+    parallel_for(pool, count, APPLY_GRAIN_PIXELS, apply_rgb_pixels, &job);
+}
+
+void levels_apply_YCbCr601(thread_pool *pool, const unsigned char *lut, unsigned char *pixels, size_t count) {
+    apply_job job = {.lut = lut, .data = pixels};
+    parallel_for(pool, count, APPLY_GRAIN_PIXELS, apply_YCbCr601_pixels, &job);
+}
@@ -139,6 +139,68 @@ int save_picture(struct picture *picture, FILE *out) {
     return SUCCESS;
 }
 
+picture *load_picture(FILE *file) {
+    char *data;
+    size_t size;
+    int ret;
+
+    if ((ret = read_all(file, &data, &size) != SUCCESS)) {
+        const char *reason;
+        switch (ret) {
+            case NOMEM:
+                reason = "no mem";
+                break;
+            case FILE_ERROR:
+                reason = "file error";
+                break;
+            case OVERFLOW_ERROR:
+                reason = "overflow";
+                break;
+            case LOGIC_ERROR:
+                reason = "logic error";
+                break;
+            default:
+                reason = "no reason";
+                break;
+        }
+        fprintf(stderr, "%s: can't read all input file.", reason);
+        return NULL;
+    }
+
+    struct picture *const picture = malloc(sizeof(struct picture) + size * sizeof(char));
+    if (picture == NULL) {
+        fprintf(stderr, "NOMEM: can't allocate memory for picture.");
+        free(data);
+        return NULL;
+    }
+
+    const char *end = NULL;
+    if ((ret = read_header(data, size, &picture->type, &picture->width, &picture->height, &picture->max_color,
+                           &picture->pixel_size, &end)) != SUCCESS) {
+        const char *reason;
+        switch (ret) {
+            case PARSE_ERROR:
+                reason = "wrong file format";
+                break;
+            case LOGIC_ERROR:
+                reason = "actual size doesn't match with size in header";
+                break;
+            default:
+                reason = "no reason";
+                break;
+        }
+        fprintf(stderr, "%s:can't parse file.", reason);
+        free(data);
+        free(picture);
+        return NULL;
+    }
+
+    memcpy(picture->data, end,
+           picture->height * picture->width * picture->pixel_size * (picture->type == P5 ? 1 : 3));
+    free(data);
+    return picture;
+}
+
 static double intersect_area_line(line l1, line l2) {
     if (l1.start > l2.start && l1.start < l2.end || l1.end > l2.start && l1.end < l2.end) {
         if (l1.start > l2.start) {
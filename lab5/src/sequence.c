@@ -0,0 +1,221 @@
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <stdint.h>
+
+#include "../include/sequence.h"
+#include "../include/picture.h"
+#include "../include/color_space.h"
+#include "../include/defines.h"
+
+bool frame_pattern_valid(const char *name) {
+    int conversions = 0;
+    for (const char *c = strchr(name, '%'); c != NULL; c = strchr(c + 1, '%')) {
+        if (c[1] == '%') {
+            ++c;
+            continue;
+        }
+        const char *d = c + 1;
+        while (isdigit((unsigned char) *d)) {
+            ++d;
+        }
+        if (*d != 'd')
+            return false;
+        ++conversions;
+        c = d;
+    }
+    return conversions == 1;
+}
+
+static int frame_name(const char *pattern, int number, filename *name) {
+    const int n = snprintf(name->data, sizeof(name->data), pattern, number);
+    return n < 0 || n >= (int) sizeof(name->data) ? OVERFLOW_ERROR : SUCCESS;
+}
+
+static int next_number(int c, FILE *stream, size_t *value) {
+    for (;;) {
+        while (c != EOF && isspace(c)) {
+            c = fgetc(stream);
+        }
+        if (c != '#')
+            break;
+        while (c != EOF && c != '\n') {
+            c = fgetc(stream);
+        }
+    }
+    if (c == EOF || !isdigit(c))
+        return PARSE_ERROR;
+
+    *value = 0;
+    for (; c != EOF && isdigit(c); c = fgetc(stream)) {
+        if (*value > (SIZE_MAX - 9) / 10)
+            return OVERFLOW_ERROR;
+        *value = *value * 10 + (c - '0');
+    }
+    // the single whitespace after the last header field is consumed here as well
+    return c == EOF || isspace(c) ? SUCCESS : PARSE_ERROR;
+}
+
+static int read_stream_frame(FILE *stream, picture **frame) {
+    *frame = NULL;
+    int c;
+    do {
+        c = fgetc(stream);
+    } while (c != EOF && isspace(c));
+    if (c == EOF)
+        return ferror(stream) ? FILE_ERROR : SUCCESS;
+
+    const int kind = fgetc(stream);
+    if (c != 'P' || (kind != '5' && kind != '6'))
+        return PARSE_ERROR;
+
+    size_t width;
+    size_t height;
+    size_t max_color;
+    int ret;
+    if ((ret = next_number(fgetc(stream), stream, &width)) != SUCCESS ||
+        (ret = next_number(fgetc(stream), stream, &height)) != SUCCESS ||
+        (ret = next_number(fgetc(stream), stream, &max_color)) != SUCCESS)
+        return ret;
+    if (max_color == 0 || max_color > 65535)
+        return PARSE_ERROR;
+
+    const size_t pixel_size = max_color > 255 ? 2 : 1;
+    const size_t channels = kind == '5' ? 1 : 3;
+    if (width != 0 && height > SIZE_MAX / width / channels / pixel_size)
+        return OVERFLOW_ERROR;
+    const size_t size = width * height * channels * pixel_size;
+
+    picture *pic = malloc(sizeof(picture) + size);
+    if (pic == NULL)
+        return NOMEM;
+    pic->type = kind == '5' ? P5 : P6;
+    pic->width = width;
+    pic->height = height;
+    pic->max_color = max_color;
+    pic->pixel_size = pixel_size;
+    if (fread(pic->data, 1, size, stream) != size) {
+        free(pic);
+        return FILE_ERROR;
+    }
+    *frame = pic;
+    return SUCCESS;
+}
+
+int frame_source_open(frame_source *source, const char *name) {
+    source->pattern = NULL;
+    source->stream = NULL;
+    source->number = 0;
+
+    if (strchr(name, '%') == NULL) {
+        source->stream = fopen(name, "rb");
+        return source->stream != NULL ? SUCCESS : FILE_ERROR;
+    }
+
+    if (!frame_pattern_valid(name))
+        return PARSE_ERROR;
+    source->pattern = name;
+
+    // numbering starts at 0 or at 1
+    filename first;
+    for (; source->number <= 1; ++source->number) {
+        if (frame_name(name, source->number, &first) != SUCCESS)
+            return OVERFLOW_ERROR;
+        FILE *file = fopen(first.data, "rb");
+        if (file != NULL) {
+            fclose(file);
+            return SUCCESS;
+        }
+    }
+    return FILE_ERROR;
+}
+
+int frame_source_next(frame_source *source, picture **frame) {
+    *frame = NULL;
+    if (source->pattern == NULL)
+        return read_stream_frame(source->stream, frame);
+
+    filename name;
+    if (frame_name(source->pattern, source->number, &name) != SUCCESS)
+        return OVERFLOW_ERROR;
+    FILE *file = fopen(name.data, "rb");
+    if (file == NULL)
+        return errno == ENOENT ? SUCCESS : FILE_ERROR;
+
+    *frame = load_picture(file);
+    fclose(file);
+    if (*frame == NULL)
+        return FILE_ERROR;
+    ++source->number;
+    return SUCCESS;
+}
+
+void frame_source_close(frame_source *source) {
+    if (source->stream != NULL)
+        fclose(source->stream);
+    source->stream = NULL;
+}
+
+int frame_sink_open(frame_sink *sink, const char *name, const frame_source *source) {
+    sink->pattern = NULL;
+    sink->stream = NULL;
+    sink->number = source->number;
+
+    if (source->pattern != NULL) {
+        if (!frame_pattern_valid(name))
+            return PARSE_ERROR;
+        sink->pattern = name;
+        return SUCCESS;
+    }
+
+    sink->stream = fopen(name, "wb");
+    return sink->stream != NULL ? SUCCESS : FILE_ERROR;
+}
+
+int frame_sink_write(frame_sink *sink, picture *frame) {
+    if (sink->pattern == NULL)
+        return save_picture(frame, sink->stream);
+
+    filename name;
+    if (frame_name(sink->pattern, sink->number, &name) != SUCCESS)
+        return OVERFLOW_ERROR;
+    FILE *file = fopen(name.data, "wb");
+    if (file == NULL)
+        return FILE_ERROR;
+    int ret = save_picture(frame, file);
+    if (fclose(file) != 0 && ret == SUCCESS)
+        ret = FILE_ERROR;
+    ++sink->number;
+    return ret;
+}
+
+int frame_sink_close(frame_sink *sink) {
+    if (sink->stream == NULL)
+        return SUCCESS;
+    const int ret = fclose(sink->stream) == 0 ? SUCCESS : FILE_ERROR;
+    sink->stream = NULL;
+    return ret;
+}
+
+static void *prefetch_main(void *arg) {
+    frame_prefetch *prefetch = arg;
+    prefetch->status = frame_source_next(prefetch->source, &prefetch->frame);
+    return NULL;
+}
+
+void frame_prefetch_start(frame_prefetch *prefetch, frame_source *source) {
+    prefetch->source = source;
+    prefetch->frame = NULL;
+    prefetch->threaded = pthread_create(&prefetch->thread, NULL, prefetch_main, prefetch) == 0;
+    if (!prefetch->threaded)
+        prefetch_main(prefetch);
+}
+
+int frame_prefetch_finish(frame_prefetch *prefetch, picture **frame) {
+    if (prefetch->threaded)
+        pthread_join(prefetch->thread, NULL);
+    prefetch->threaded = false;
+    *frame = prefetch->frame;
+    return prefetch->status;
+}
@@ -5,231 +5,479 @@
 #include <string.h>
 #include <math.h>
 #include <assert.h>
+#include <stdbool.h>
 
 #include "../include/defines.h"
 #include "../include/picture.h"
 #include "../include/utility.h"
 #include "../include/color_space.h"
-
-unsigned char do_correction(unsigned char val, long offset, float factor) {
-    return round(fmaxf(0.f, fminf(255.f, fmaxf(0.f, (float) (val - offset)) * factor)));
+#include "../include/thread_pool.h"
+#include "../include/levels.h"
+#include "../include/histogram.h"
+#include "../include/clahe.h"
+#include "../include/sequence.h"
+
+#define SAMPLE_CONFIDENCE_Z 3.
+#define CLAHE_DEFAULT_TILES 8
+#define CLAHE_DEFAULT_CLIP 2.f
+
+// the darkest and brightest 0.39% of samples are ignored by modes 4 and 5
+static size_t skipped_samples(picture *pic) {
+    return 0.0039 * picture_size(pic);
 }
 
-unsigned char auto_correction(unsigned char val, int min_val, unsigned char max_val) {
-    return round(fmaxf(0.f, fminf(255.f, fmaxf(0.f, (float) (val - min_val)) * 255.f / (float) (max_val - min_val))));
-}
+typedef enum {
+    CUT_EXACT = 0, CUT_SAMPLED, CUT_SAMPLED_CHECKED
+} cut_method;
 
-void rgb_correct(unsigned char *r, unsigned char *g, unsigned char *b, long offset, float factor) {
-    *r = do_correction(*r, offset, factor);
-    *g = do_correction(*g, offset, factor);
-    *b = do_correction(*b, offset, factor);
-}
+typedef struct {
+    unsigned type;
+    long offset;
+    float factor;
+    cut_method cut;
+    double sample_share;
+    int tiles;
+    float clip;
+    const char *reference_name;
+} transformation;
+
+// sampled methods count only every 1/sample_share-th row, the checked one also every sample when the
+// estimated cut could fall into a neighbouring bin
+static void find_cut(thread_pool *pool, picture *pic, bool luma, cut_method method, double sample_share,
+                     unsigned char *min, unsigned char *max) {
+    const size_t row_size = luma ? pic->width : (pic->type == P5 ? 1 : 3) * pic->width;
+    const size_t samples = row_size * pic->height;
+    const size_t step = (size_t) (1. / sample_share + 0.5);
+    histogram hist;
+
+    if (method != CUT_EXACT && step > 1 && samples > 0) {
+        if (luma)
+            histogram_build_YCbCr601_rows(pool, &hist, pic->data, pic->width, pic->height, step);
+        else
+            histogram_build_rows(pool, &hist, pic->data, row_size, pic->height, step);
+
+        const double fraction = (double) skipped_samples(pic) / (double) samples;
+        histogram_cut_estimate estimate;
+        histogram_estimate_cut(&hist, fraction, SAMPLE_CONFIDENCE_Z, &estimate);
+        const bool sure = estimate.min_low == estimate.min_high && estimate.max_low == estimate.max_high;
+        fprintf(stderr, "sampled %zu of %zu samples, cut %.3f%% +- %.3f%%: min %d in [%d;%d], max %d in [%d;%d]%s.\n",
+                hist.total, samples, 100. * fraction, 100. * estimate.bound, estimate.min, estimate.min_low,
+                estimate.min_high, estimate.max, estimate.max_low, estimate.max_high,
+                method == CUT_SAMPLED_CHECKED && !sure ? ", exact pass" : "");
+        if (method == CUT_SAMPLED || sure) {
+            *min = estimate.min;
+            *max = estimate.max;
+            return;
+        }
+    }
 
-void YCbCr601_correct(unsigned char *y, unsigned char *cb, unsigned char *cr,
-                      long offset, float factor) {
-    *y = do_correction(*y, offset, factor);
+    if (luma)
+        histogram_build_YCbCr601(pool, &hist, pic->data, pic->width * pic->height);
+    else
+        histogram_build(pool, &hist, pic->data, picture_size(pic));
+    histogram_min_max_with_skip(&hist, skipped_samples(pic), min, max);
 }
 
-void rgb_auto_correct(unsigned char *r, unsigned char *g, unsigned char *b, unsigned char max_val, unsigned min_val) {
-    *r = auto_correction(*r, min_val, max_val);
-    *g = auto_correction(*g, min_val, max_val);
-    *b = auto_correction(*b, min_val, max_val);
+// histogram matching modes take the target distribution from a reference picture, for the luma modes a P6 one
+// gives its YCbCr.601 luma and a P5 one its gray values
+static int build_reference_histogram(thread_pool *pool, const char *name, bool luma, histogram *hist) {
+    if (name == NULL) {
+        fprintf(stderr, "histogram matching needs -r <reference file>.");
+        return LOGIC_ERROR;
+    }
+
+    FILE *file = fopen(name, "rb");
+    if (file == NULL) {
+        perror("can't open reference file.");
+        return FILE_ERROR;
+    }
+    picture *reference = load_picture(file);
+    fclose(file);
+    if (reference == NULL)
+        return FILE_ERROR;
+
+    if (luma && reference->type == P6)
+        histogram_build_YCbCr601(pool, hist, reference->data, reference->width * reference->height);
+    else
+        histogram_build(pool, hist, reference->data, picture_size(reference));
+    free(reference);
+    return SUCCESS;
 }
 
-void YCbCr601_auto_correct(unsigned char *y, unsigned char *cb, unsigned char *cr,
-                           unsigned char min_val, unsigned max_val) {
-    *y = auto_correction(*y, min_val, max_val);
+// prints the offset and factor levels_lut_auto stretches with, a flat range is left as it is
+static void print_auto_levels(const char *separator, unsigned char min, unsigned char max) {
+    if (max > min)
+        printf("%s%d %f", separator, min, 255.f / (max - min));
+    else
+        printf("%s%d %f", separator, 0, 1.f);
 }
 
-typedef void (*correct_policy)(unsigned char *s1, unsigned char *s2, unsigned char *s3, long offset,
-                               float factor);
+// modes 2-5 stretch the picture's own range and print it, in sequence mode the offset and factor of the smoothed range are
+// applied and printed instead
+static void auto_levels_lut(unsigned char *lut, unsigned char min, unsigned char max, levels_smoothing *smoothing) {
+    if (smoothing == NULL) {
+        levels_lut_auto(lut, min, max);
+        print_auto_levels("", min, max);
+        return;
+    }
 
-typedef void (*auto_correct_policy)(unsigned char *s1, unsigned char *s2, unsigned char *s3,
-                                    unsigned char min_val, unsigned max_val);
+    long offset;
+    float factor;
+    levels_smoothing_update(smoothing, min, max, &offset, &factor);
+    levels_lut_manual(lut, offset, factor);
+    printf("%ld %f", offset, factor);
+}
 
-void correct_3(picture *pic, long offset, float factor, correct_policy policy) {
-    assert(pic->type == P6);
-    for (size_t y = 0; y < pic->height; ++y) {
-        for (int x = 0; x < pic->width; ++x) {
-            unsigned char *c = get_data(pic, x, y);
-            policy(c, c + 1, c + 2, offset, factor);
+// applies the transformation in place, reasons for failures are printed
+static int transform(thread_pool *pool, struct picture *picture, const transformation *t,
+                     levels_smoothing *smoothing) {
+    // every mode only builds the 256-entry mapping and then makes a single pass over the pixels
+    unsigned char lut[LEVELS_LUT_SIZE];
+    histogram hist;
+    switch (t->type) {
+        case 0: {
+            levels_lut_manual(lut, t->offset, t->factor);
+            levels_apply(pool, lut, picture->data, picture_size(picture));
+            break;
         }
-    }
-}
+        case 1: {
+            if (picture->type == P5) {
+                fprintf(stderr, "picture should have type P6.");
+                return LOGIC_ERROR;
+            }
 
-void auto_correct_3(picture *pic, auto_correct_policy policy, unsigned char min, unsigned char max) {
-    assert(pic->type == P6);
-    for (size_t y = 0; y < pic->height; ++y) {
-        for (int x = 0; x < pic->width; ++x) {
-            unsigned char *c = get_data(pic, x, y);
-            policy(c, c + 1, c + 2, min, max);
+            levels_lut_manual(lut, t->offset, t->factor);
+            levels_apply_YCbCr601(pool, lut, picture->data, picture->width * picture->height);
+            break;
         }
-    }
-}
 
-void correct(picture *pic, long offset, float factor) {
-    for (size_t i = 0; i < picture_size(pic); ++i) {
-        pic->data[i] = do_correction(pic->data[i], offset, factor);
-    }
-}
+        case 2: {
+            unsigned char max;
+            unsigned char min;
+            histogram_build(pool, &hist, picture->data, picture_size(picture));
+            histogram_min_max(&hist, &min, &max);
 
-void auto_correct(picture *pic, auto_correct_policy policy, unsigned char min, unsigned char max) {
-    for (size_t i = 0; i < picture_size(pic); ++i) {
-        pic->data[i] = auto_correction(pic->data[i], min, max);
-    }
-}
+            auto_levels_lut(lut, min, max, smoothing);
+            levels_apply(pool, lut, picture->data, picture_size(picture));
+            break;
+        }
 
-void rgb_find_min_max(picture *pic, unsigned char *min, unsigned char *max) {
-    assert(pic != NULL && min != NULL && max != NULL);
-    *min = 255;
-    *max = 0;
-    for (size_t i = 0; i < picture_size(pic); ++i) {
-        *max = fmax(pic->data[i], *max);
-        *min = fmin(pic->data[i], *min);
-    }
-}
+        case 3: {
+            unsigned char max;
+            unsigned char min;
 
-void rgb_find_min_max_with_skip(picture *pic, unsigned char *min, unsigned char *max) {
-    assert(min != NULL && max != NULL);
-    int cnt[256] = {};
-    for (size_t i = 0; i < picture_size(pic); ++i) {
-        ++cnt[pic->data[i]];
-    }
+            if (picture->type == P5) {
+                fprintf(stderr, "picture should have type P6.");
+                return LOGIC_ERROR;
+            }
 
-    *min = 255;
-    *max = 0;
+            histogram_build_YCbCr601(pool, &hist, picture->data, picture->width * picture->height);
+            histogram_min_max(&hist, &min, &max);
 
-    const int skip = 0.0039 * picture_size(pic);
-    int count = 0;
-    for (int i = 0; i < sizeof(cnt) / sizeof(cnt[0]); ++i) {
-        if (count + cnt[i] < skip) {
-            count += cnt[i];
-        } else {
-            *min = i;
+            auto_levels_lut(lut, min, max, smoothing);
+            levels_apply_YCbCr601(pool, lut, picture->data, picture->width * picture->height);
             break;
         }
-    }
 
-    count = 0;
+        case 4: {
+            unsigned char max;
+            unsigned char min;
+
+            find_cut(pool, picture, false, t->cut, t->sample_share, &min, &max);
 
-    for (int i = sizeof(cnt) / sizeof(cnt[0]) - 1; i >= 0; --i) {
-        if (count + cnt[i] < skip) {
-            count += cnt[i];
-        } else {
-            *max = i;
+            auto_levels_lut(lut, min, max, smoothing);
+            levels_apply(pool, lut, picture->data, picture_size(picture));
             break;
         }
-    }
-}
 
-void YCbCr601_find_min_max(picture *pic, unsigned char *min, unsigned char *max) {
-    assert(pic->type == P6 && min != NULL && max != NULL);
-    *min = 255;
-    *max = 0;
-    for (size_t y = 0; y < pic->height; ++y) {
-        for (size_t x = 0; x < pic->width; ++x) {
-            *max = fmax(*get_data(pic, x, y), *max);
-            *min = fmin(*get_data(pic, x, y), *min);
+        case 5: {
+            unsigned char max;
+            unsigned char min;
+
+            if (picture->type == P5) {
+                fprintf(stderr, "picture should have type P6.");
+                return LOGIC_ERROR;
+            }
+
+            find_cut(pool, picture, true, t->cut, t->sample_share, &min, &max);
+
+            auto_levels_lut(lut, min, max, smoothing);
+            levels_apply_YCbCr601(pool, lut, picture->data, picture->width * picture->height);
+            break;
         }
-    }
-}
 
-void YCbCr601_find_min_max_with_skip(picture *pic,
-                                     unsigned char *min, unsigned char *max) {
-    assert(pic->type == P6 && min != NULL && max != NULL);
-    int cnt[256] = {};
-    for (size_t y = 0; y < pic->height; ++y) {
-        for (size_t x = 0; x < pic->width; ++x) {
-            ++cnt[*get_data(pic, x, y)];
+        case 6: {
+            if (clahe_apply(pool, picture->data, picture->width, picture->height, picture->type == P5 ? 1 : 3,
+                            t->tiles, t->clip) != SUCCESS) {
+                fprintf(stderr, "NOMEM: can't allocate tile histograms.");
+                return LOGIC_ERROR;
+            }
+            break;
+        }
+
+        case 7:
+        case 9: {
+            histogram_build(pool, &hist, picture->data, picture_size(picture));
+            if (t->type == 7) {
+                levels_lut_equalise(lut, &hist);
+            } else {
+                histogram reference;
+                if (build_reference_histogram(pool, t->reference_name, false, &reference) != SUCCESS)
+                    return LOGIC_ERROR;
+                levels_lut_match(lut, &hist, &reference);
+            }
+            levels_apply(pool, lut, picture->data, picture_size(picture));
+            break;
         }
-    }
 
-    *min = 255;
-    *max = 0;
+        case 8:
+        case 10: {
+            if (picture->type == P5) {
+                fprintf(stderr, "picture should have type P6.");
+                return LOGIC_ERROR;
+            }
 
-    const int skip = 0.0039 * picture_size(pic);
-    int count = 0;
-    for (size_t i = 0; i < sizeof(cnt) / sizeof(cnt[0]); ++i) {
-        if (count + cnt[i] < skip) {
-            count += cnt[i];
-        } else {
-            *min = i;
+            histogram_build_YCbCr601(pool, &hist, picture->data, picture->width * picture->height);
+            if (t->type == 8) {
+                levels_lut_equalise(lut, &hist);
+            } else {
+                histogram reference;
+                if (build_reference_histogram(pool, t->reference_name, true, &reference) != SUCCESS)
+                    return LOGIC_ERROR;
+                levels_lut_match(lut, &hist, &reference);
+            }
+            levels_apply_YCbCr601(pool, lut, picture->data, picture->width * picture->height);
             break;
         }
-    }
 
-    count = 0;
+        case 11:
+        case 12:
+        case 13: {
+            if (picture->type == P5) {
+                fprintf(stderr, "picture should have type P6.");
+                return LOGIC_ERROR;
+            }
+
+            // all three channels are counted in the same pass
+            histogram channels[3];
+            unsigned char luts[3 * LEVELS_LUT_SIZE];
+            histogram_build_rgb(pool, channels, picture->data, picture->width * picture->height);
+
+            if (t->type == 13) {
+                // gray world: every channel is scaled so its mean matches the mean of all three
+                double means[3];
+                for (int k = 0; k < 3; ++k) {
+                    means[k] = histogram_mean(&channels[k]);
+                }
+                const double gray = (means[0] + means[1] + means[2]) / 3.;
+                for (int k = 0; k < 3; ++k) {
+                    const float gain = means[k] > 0. ? gray / means[k] : 1.f;
+                    levels_lut_manual(luts + k * LEVELS_LUT_SIZE, 0, gain);
+                    printf(k == 0 ? "%f" : " %f", gain);
+                }
+            } else {
+                for (int k = 0; k < 3; ++k) {
+                    unsigned char max;
+                    unsigned char min;
+                    if (t->type == 11)
+                        histogram_min_max(&channels[k], &min, &max);
+                    else
+                        histogram_min_max_with_skip(&channels[k], 0.0039 * channels[k].total, &min, &max);
+                    levels_lut_auto(luts + k * LEVELS_LUT_SIZE, min, max);
+                    print_auto_levels(k == 0 ? "" : " ", min, max);
+                }
+            }
 
-    for (int i = sizeof(cnt) / sizeof(cnt[0]) - 1; i >= 0; --i) {
-        if (count + cnt[i] < skip) {
-            count += cnt[i];
-        } else {
-            *max = i;
+            levels_apply_rgb(pool, luts, picture->data, picture->width * picture->height);
             break;
         }
+
+        default: {
+            fprintf(stderr, "Unhandled transformation type.\n");
+            return LOGIC_ERROR;
+        }
+
     }
+    return SUCCESS;
 }
 
-static void YCbCr601_to_rgb(picture *pic) {
-    assert(pic->type == P6);
+// modes printing their levels, in sequence mode every frame gets its own line
+static bool prints_levels(unsigned type) {
+    return (type >= 2 && type <= 5) || (type >= 11 && type <= 13);
+}
 
-    for (size_t y = 0; y < pic->height; ++y) {
-        for (size_t x = 0; x < pic->width; ++x) {
-            unsigned char *c = get_data(pic, x, y);
-            YCbCr_601_to_rgb_pixel(c, c + 1, c + 2);
-        }
+// every frame goes through the same transformation while the next one is read, and the auto levels modes
+// smooth the range they stretch over the frames
+static int run_sequence(const char *input, const char *output, const transformation *t, int threads,
+                        double alpha) {
+    frame_source source;
+    frame_sink sink;
+    if (frame_source_open(&source, input) != SUCCESS) {
+        fprintf(stderr, "can't open input frames %s.", input);
+        return EXIT_FAILURE;
+    }
+    if (frame_sink_open(&sink, output, &source) != SUCCESS) {
+        fprintf(stderr, "can't open output frames %s.", output);
+        frame_source_close(&source);
+        return EXIT_FAILURE;
     }
-}
 
-static void rgb_to_YCbCr601(picture *pic) {
-    assert(pic->type == P6);
+    int result = EXIT_FAILURE;
+    levels_smoothing smoothing = {.alpha = alpha};
+    frame_prefetch prefetch;
+    picture *frame = NULL;
+    thread_pool *pool = thread_pool_create(threads);
+    if (pool == NULL) {
+        fprintf(stderr, "NOMEM: can't create thread pool.");
+        goto clear;
+    }
 
-    for (size_t y = 0; y < pic->height; ++y) {
-        for (size_t x = 0; x < pic->width; ++x) {
-            unsigned char *c = get_data(pic, x, y);
-            YCbCr_601_from_rgb_pixel(c, c + 1, c + 2);
+    frame_prefetch_start(&prefetch, &source);
+    for (size_t n = 0;; ++n) {
+        if (frame_prefetch_finish(&prefetch, &frame) != SUCCESS) {
+            fprintf(stderr, "can't read frame %zu.", n);
+            goto clear;
+        }
+        if (frame == NULL)
+            break;
+        frame_prefetch_start(&prefetch, &source);
+
+        int ret = transform(pool, frame, t, &smoothing);
+        if (ret == SUCCESS && prints_levels(t->type))
+            putchar('\n');
+        if (ret == SUCCESS && (ret = frame_sink_write(&sink, frame)) != SUCCESS)
+            fprintf(stderr, "can't write frame %zu.", n);
+        free(frame);
+        frame = NULL;
+
+        if (ret != SUCCESS) {
+            frame_prefetch_finish(&prefetch, &frame);
+            goto clear;
         }
     }
+
+    if (frame_sink_close(&sink) != SUCCESS)
+        fprintf(stderr, "can't write output frames %s.", output);
+    else
+        result = EXIT_SUCCESS;
+
+    clear:
+    free(frame);
+    thread_pool_destroy(pool);
+    frame_sink_close(&sink);
+    frame_source_close(&source);
+    return result;
 }
 
 int task5(int argc, char *argv[]) {
+    int threads = default_thread_count();
+    transformation t = {
+            .cut = CUT_EXACT,
+            .sample_share = 1.,
+            .tiles = CLAHE_DEFAULT_TILES,
+            .clip = CLAHE_DEFAULT_CLIP
+    };
+    double smoothing = 0.;
+    // trailing options, the positional arguments stay in place
+    while (argc >= 3 && argv[argc - 2][0] == '-' && argv[argc - 2][1] != '\0' &&
+           strchr("jsSgcra", argv[argc - 2][1]) != NULL && argv[argc - 2][2] == '\0') {
+        switch (argv[argc - 2][1]) {
+            case 'j':
+                READ_INT(threads, argv[argc - 1], {
+                    perror("error in parsing <потоки>.");
+                    return EXIT_FAILURE;
+                }, strtol);
+                if (threads < 1) {
+                    fprintf(stderr, "threads must be positive");
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 's':
+            case 'S':
+                READ_FLOAT(t.sample_share, argv[argc - 1], {
+                    perror("error in parsing <доля_строк>.");
+                    return EXIT_FAILURE;
+                }, strtod);
+                if (!(t.sample_share > 0. && t.sample_share <= 1.)) {
+                    fprintf(stderr, "sampled share of rows must be in (0;1]");
+                    return EXIT_FAILURE;
+                }
+                t.cut = argv[argc - 2][1] == 's' ? CUT_SAMPLED : CUT_SAMPLED_CHECKED;
+                break;
+            case 'g':
+                READ_INT(t.tiles, argv[argc - 1], {
+                    perror("error in parsing <тайлы>.");
+                    return EXIT_FAILURE;
+                }, strtol);
+                if (t.tiles < 1 || t.tiles > CLAHE_MAX_TILES) {
+                    fprintf(stderr, "tiles must be in [1;%d]", CLAHE_MAX_TILES);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'r':
+                t.reference_name = argv[argc - 1];
+                break;
+            case 'a':
+                READ_FLOAT(smoothing, argv[argc - 1], {
+                    perror("error in parsing <сглаживание>.");
+                    return EXIT_FAILURE;
+                }, strtod);
+                if (!(smoothing > 0. && smoothing <= 1.)) {
+                    fprintf(stderr, "smoothing must be in (0;1]");
+                    return EXIT_FAILURE;
+                }
+                break;
+            default:
+                READ_FLOAT(t.clip, argv[argc - 1], {
+                    perror("error in parsing <ограничение>.");
+                    return EXIT_FAILURE;
+                }, strtof);
+                if (!(t.clip >= 1.f)) {
+                    fprintf(stderr, "clip limit must be at least 1");
+                    return EXIT_FAILURE;
+                }
+                break;
+        }
+        argc -= 2;
+    }
+
     if (argc != 4 && argc != 6) {
         fprintf(stderr,
                 "usage:\n%s  <имя_входного_файла> <имя_выходного_файла> "
-                "<преобразование> [<смещение> <множитель>]\n",
+                "<преобразование> [<смещение> <множитель>] [-j <потоки>] [-s|-S <доля_строк>]"
+                "  [-g <тайлы>] [-c <ограничение>] [-r <эталонный_файл>] [-a <сглаживание>]\n",
                 argv[0]);
         return EXIT_FAILURE;
     }
 
-    unsigned transformation_type;
-    READ_INT(transformation_type, argv[3], {
+    READ_INT(t.type, argv[3], {
         perror("error in parsing <преобразование>.");
         return EXIT_FAILURE;
     }, strtol);
 
-    long offset;
-    float factor;
-
     if (argc == 6) {
-        READ_INT(offset, argv[4], {
+        READ_INT(t.offset, argv[4], {
             perror("error in parsing <смещение>.");
             return EXIT_FAILURE;
         }, strtol);
-        if (offset < -255 || offset > 255) {
+        if (t.offset < -255 || t.offset > 255) {
             fprintf(stderr, "offset must be in [0;255]");
             return EXIT_FAILURE;
         }
 
-        READ_FLOAT(factor, argv[5], {
+        READ_FLOAT(t.factor, argv[5], {
             perror("error in parsing <множитель>.");
             return EXIT_FAILURE;
         }, strtof);
-        if (factor < 0 || factor > 255) {
+        if (t.factor < 0 || t.factor > 255) {
             fprintf(stderr, "offset must be in [0;255]");
             return EXIT_FAILURE;
         }
     }
 
+    if (smoothing > 0.)
+        return run_sequence(argv[1], argv[2], &t, threads, smoothing);
+
     FILE *input_file = fopen(argv[1], "rb");
     if (input_file == NULL) {
         perror("can't open input file.");
@@ -242,151 +490,20 @@ int task5(int argc, char *argv[]) {
         goto error_close_input_file;
     }
 
-    char *data;
-    size_t size;
     int ret;
-
-    if ((ret = read_all(input_file, &data, &size) != SUCCESS)) {
-        const char *reason;
-        switch (ret) {
-            case NOMEM:
-                reason = "no mem";
-                break;
-            case FILE_ERROR:
-                reason = "file error";
-                break;
-            case OVERFLOW_ERROR:
-                reason = "overflow";
-                break;
-            case LOGIC_ERROR:
-                reason = "logic error";
-                break;
-            default:
-                reason = "no reason";
-                break;
-        }
-        fprintf(stderr, "%s: can't read all input file.", reason);
-        goto error_close_files;
-    }
-
-    struct picture *const picture = malloc(sizeof(struct picture) + size * sizeof(char));
-
-    if (picture == NULL) {
-        fprintf(stderr, "NOMEM: can't allocate memory for picture.");
-        free(data);
+    struct picture *const picture = load_picture(input_file);
+    thread_pool *pool = NULL;
+    if (picture == NULL)
         goto error_close_files;
-    }
 
-    const char *end = NULL;
-    if ((ret = read_header(data, size, &picture->type, &picture->width, &picture->height, &picture->max_color,
-                           &picture->pixel_size, &end)) != SUCCESS) {
-        const char *reason;
-        switch (ret) {
-            case PARSE_ERROR:
-                reason = "wrong file format";
-                break;
-            case LOGIC_ERROR:
-                reason = "actual size doesn't match with size in header";
-                break;
-            default:
-                reason = "no reason";
-                break;
-        }
-        fprintf(stderr, "%s:can't parse file.", reason);
-        free(data);
+    pool = thread_pool_create(threads);
+    if (pool == NULL) {
+        fprintf(stderr, "NOMEM: can't create thread pool.");
         goto error;
     }
 
-    memcpy(picture->data, end,
-           picture->height * picture->width * picture->pixel_size * (picture->type == P5 ? 1 : 3));
-    free(data);
-
-    switch (transformation_type) {
-        case 0: {
-            correct(picture, offset, factor);
-            break;
-        }
-        case 1: {
-            rgb_to_YCbCr601(picture);
-
-            if (picture->type == P5) {
-                fprintf(stderr, "picture should have type P6.");
-                goto error;
-            }
-
-            correct_3(picture, offset, factor, YCbCr601_correct);
-
-            YCbCr601_to_rgb(picture);
-            break;
-        }
-
-        case 2: {
-            unsigned char max;
-            unsigned char min;
-            rgb_find_min_max(picture, &min, &max);
-
-            auto_correct(picture, rgb_auto_correct, min, max);
-
-            printf("%d %f", min, 255.f / (max - min));
-            break;
-        }
-
-        case 3: {
-            unsigned char max;
-            unsigned char min;
-
-            if (picture->type == P5) {
-                fprintf(stderr, "picture should have type P6.");
-                goto error;
-            }
-
-            rgb_to_YCbCr601(picture);
-            YCbCr601_find_min_max(picture, &min, &max);
-
-            auto_correct_3(picture, YCbCr601_auto_correct, min, max);
-
-            YCbCr601_to_rgb(picture);
-            printf("%d %f", min, 255.f / (max - min));
-            break;
-        }
-
-        case 4: {
-            unsigned char max;
-            unsigned char min;
-
-            rgb_find_min_max_with_skip(picture, &min, &max);
-
-            auto_correct(picture, rgb_auto_correct, min, max);
-
-            printf("%d %f", min, 255.f / (max - min));
-            break;
-        }
-
-        case 5: {
-            unsigned char max;
-            unsigned char min;
-
-            if (picture->type == P5) {
-                fprintf(stderr, "picture should have type P6.");
-                goto error;
-            }
-
-            rgb_to_YCbCr601(picture);
-            YCbCr601_find_min_max_with_skip(picture, &min, &max);
-
-            auto_correct_3(picture, YCbCr601_auto_correct, min, max);
-
-            YCbCr601_to_rgb(picture);
-            printf("%d %f", min, 255.f / (max - min));
-            break;
-        }
-
-        default: {
-            fprintf(stderr, "Unhandled transformation type.\n");
-            goto error;
-        }
-
-    }
+    if (transform(pool, picture, &t, NULL) != SUCCESS)
+        goto error;
 
     if ((ret = save_picture(picture, output_file)) != SUCCESS) {
         const char *reason;
@@ -406,12 +523,14 @@ int task5(int argc, char *argv[]) {
     }
 
     clear:
+    thread_pool_destroy(pool);
     fclose(input_file);
     fclose(output_file);
     free(picture);
     return EXIT_SUCCESS;
 
     error:
+    thread_pool_destroy(pool);
     free(picture);
     error_close_files:
     fclose(output_file);
@@ -0,0 +1,114 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../include/histogram.h"
+#include "../include/color_space.h"
+#include "../include/thread_pool.h"
+
+// several flushes of the banks inside one chunk, which one thread runs as a whole
+#define PIXELS 1000003
+#define WIDTH 1009
+#define STEP 3
+
+static unsigned int seed = 12345;
+
+static unsigned char random_byte(void) {
+    seed = seed * 1103515245u + 12345u;
+    return seed >> 16;
+}
+
+static int compare(const char *name, const histogram *expected, const histogram *actual) {
+    if (expected->total != actual->total || memcmp(expected->count, actual->count, sizeof(expected->count)) != 0) {
+        fprintf(stderr, "%s histogram differs, %zu samples instead of %zu\n", name, actual->total, expected->total);
+        return 1;
+    }
+    return 0;
+}
+
+static void count(histogram *hist, unsigned char value) {
+    ++hist->count[value];
+    ++hist->total;
+}
+
+// long runs of one value, the case the banks exist for, then noise
+static void fill(unsigned char *pixels) {
+    for (size_t i = 0; i < 3 * PIXELS; ++i) {
+        pixels[i] = i < 3 * PIXELS / 2 ? 200 : random_byte();
+    }
+}
+
+static int check(thread_pool *pool, const unsigned char *pixels) {
+    const size_t height = PIXELS / WIDTH;
+    histogram expected[3];
+    histogram actual[3];
+    int failed = 0;
+
+    memset(expected, 0, sizeof(expected));
+    for (size_t i = 0; i < 3 * PIXELS; ++i) {
+        count(&expected[0], pixels[i]);
+    }
+    histogram_build(pool, &actual[0], pixels, 3 * PIXELS);
+    failed += compare("byte", &expected[0], &actual[0]);
+
+    memset(expected, 0, sizeof(expected));
+    for (size_t i = 0; i < PIXELS; ++i) {
+        count(&expected[0], YCbCr_601_luma(pixels + 3 * i));
+    }
+    histogram_build_YCbCr601(pool, &actual[0], pixels, PIXELS);
+    failed += compare("luma", &expected[0], &actual[0]);
+
+    memset(expected, 0, sizeof(expected));
+    for (size_t i = 0; i < PIXELS; ++i) {
+        for (int k = 0; k < 3; ++k) {
+            count(&expected[k], pixels[3 * i + k]);
+        }
+    }
+    histogram_build_rgb(pool, actual, pixels, PIXELS);
+    for (int k = 0; k < 3; ++k) {
+        failed += compare("rgb channel", &expected[k], &actual[k]);
+    }
+
+    memset(expected, 0, sizeof(expected));
+    for (size_t row = STEP / 2; row < height; row += STEP) {
+        for (size_t x = 0; x < 3 * WIDTH; ++x) {
+            count(&expected[0], pixels[row * 3 * WIDTH + x]);
+        }
+        for (size_t x = 0; x < WIDTH; ++x) {
+            count(&expected[1], YCbCr_601_luma(pixels + 3 * (row * WIDTH + x)));
+        }
+    }
+    histogram_build_rows(pool, &actual[0], pixels, 3 * WIDTH, height, STEP);
+    failed += compare("sampled rows", &expected[0], &actual[0]);
+    histogram_build_YCbCr601_rows(pool, &actual[1], pixels, WIDTH, height, STEP);
+    failed += compare("sampled luma rows", &expected[1], &actual[1]);
+
+    return failed;
+}
+
+int main(void) {
+    unsigned char *pixels = malloc(3 * PIXELS);
+    if (pixels == NULL) {
+        fprintf(stderr, "no mem\n");
+        return EXIT_FAILURE;
+    }
+    fill(pixels);
+
+    int failed = 0;
+    const int threads[] = {1, 4};
+    for (size_t t = 0; t < sizeof(threads) / sizeof(threads[0]) && !failed; ++t) {
+        thread_pool *pool = thread_pool_create(threads[t]);
+        if (pool == NULL) {
+            fprintf(stderr, "no mem\n");
+            failed = 1;
+            break;
+        }
+        failed += check(pool, pixels);
+        thread_pool_destroy(pool);
+    }
+
+    free(pixels);
+    if (failed == 0)
+        printf("banked histograms match a plain count\n");
+    return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
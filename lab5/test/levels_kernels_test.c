@@ -0,0 +1,84 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../include/levels.h"
+
+#define MAX_COUNT 1000
+
+// 32 bytes fill one vector, the others are empty, shorter than one or end in a scalar tail
+static const size_t counts[] = {0, 1, 31, 32, 33, 1000};
+
+static unsigned int seed = 12345;
+
+static unsigned char random_byte(void) {
+    seed = seed * 1103515245u + 12345u;
+    return seed >> 16;
+}
+
+// every byte value appears in long inputs, the rest is random
+static void fill_data(unsigned char *data, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        data[i] = i < LEVELS_LUT_SIZE && count >= LEVELS_LUT_SIZE ? i : random_byte();
+    }
+}
+
+static int check_lut(const char *name, const unsigned char *lut) {
+    unsigned char source[MAX_COUNT + 1];
+    unsigned char expected[MAX_COUNT + 1];
+    unsigned char actual[MAX_COUNT + 1];
+
+    int failed = 0;
+    for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); ++c) {
+        // the second pass starts off a 32-byte boundary
+        for (size_t shift = 0; shift < 2; ++shift) {
+            const size_t count = counts[c];
+            fill_data(source + shift, count);
+            memcpy(expected + shift, source + shift, count);
+            memcpy(actual + shift, source + shift, count);
+            levels_apply_scalar(lut, expected + shift, count);
+            levels_apply_avx2(lut, actual + shift, count);
+            if (memcmp(expected + shift, actual + shift, count) != 0) {
+                fprintf(stderr, "%s table, %zu bytes at offset %zu differ\n", name, count, shift);
+                failed = 1;
+            }
+        }
+    }
+    return failed;
+}
+
+int main(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (!__builtin_cpu_supports("avx2")) {
+        printf("no avx2, nothing to compare\n");
+        return EXIT_SUCCESS;
+    }
+#else
+    printf("no vector kernel, nothing to compare\n");
+    return EXIT_SUCCESS;
+#endif
+
+    unsigned char identity[LEVELS_LUT_SIZE];
+    unsigned char zero[LEVELS_LUT_SIZE];
+    unsigned char full[LEVELS_LUT_SIZE];
+    unsigned char reversed[LEVELS_LUT_SIZE];
+    unsigned char random[LEVELS_LUT_SIZE];
+    for (int i = 0; i < LEVELS_LUT_SIZE; ++i) {
+        identity[i] = i;
+        zero[i] = 0;
+        full[i] = 255;
+        reversed[i] = 255 - i;
+        random[i] = random_byte();
+    }
+
+    int failed = check_lut("identity", identity);
+    failed += check_lut("all 0", zero);
+    failed += check_lut("all 255", full);
+    failed += check_lut("reversed", reversed);
+    failed += check_lut("random", random);
+
+    if (failed == 0)
+        printf("avx2 levels kernel bit-exact with the scalar one\n");
+    return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
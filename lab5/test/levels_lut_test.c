@@ -0,0 +1,93 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../include/levels.h"
+#include "../include/histogram.h"
+#include "../include/thread_pool.h"
+
+#define WIDTH 64
+#define HEIGHT 32
+
+// min goes to 0, max to 255, the values between rise and the ones outside are clamped
+static int check_stretch(unsigned char min, unsigned char max) {
+    unsigned char lut[LEVELS_LUT_SIZE];
+    levels_lut_auto(lut, min, max);
+    for (int i = 0; i < LEVELS_LUT_SIZE; ++i) {
+        const int expected_bound = i <= min ? 0 : i >= max ? 255 : -1;
+        if (expected_bound >= 0 ? lut[i] != expected_bound : lut[i] < lut[i - 1]) {
+            fprintf(stderr, "[%d, %d] stretches %d to %d\n", min, max, i, lut[i]);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int check_flat(unsigned char min, unsigned char max) {
+    unsigned char lut[LEVELS_LUT_SIZE];
+    levels_lut_auto(lut, min, max);
+    for (int i = 0; i < LEVELS_LUT_SIZE; ++i) {
+        if (lut[i] != i) {
+            fprintf(stderr, "flat [%d, %d] maps %d to %d\n", min, max, i, lut[i]);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// per-channel levels on a picture without red, as modes 11 and 12 build them, must keep red at 0
+static int check_flat_channel(void) {
+    static unsigned char pixels[WIDTH * HEIGHT * 3];
+    for (int y = 0; y < HEIGHT; ++y) {
+        for (int x = 0; x < WIDTH; ++x) {
+            unsigned char *c = pixels + (y * WIDTH + x) * 3;
+            c[0] = 0;
+            c[1] = 30 + x * 150 / (WIDTH - 1);
+            c[2] = 10 + y * 200 / (HEIGHT - 1);
+        }
+    }
+
+    thread_pool *pool = thread_pool_create(1);
+    if (pool == NULL) {
+        fprintf(stderr, "no mem\n");
+        return 1;
+    }
+    histogram channels[3];
+    unsigned char luts[3 * LEVELS_LUT_SIZE];
+    histogram_build_rgb(pool, channels, pixels, WIDTH * HEIGHT);
+    for (int k = 0; k < 3; ++k) {
+        unsigned char min;
+        unsigned char max;
+        histogram_min_max(&channels[k], &min, &max);
+        levels_lut_auto(luts + k * LEVELS_LUT_SIZE, min, max);
+    }
+    levels_apply_rgb(pool, luts, pixels, WIDTH * HEIGHT);
+    thread_pool_destroy(pool);
+
+    int failed = 0;
+    for (int i = 0; i < WIDTH * HEIGHT && !failed; ++i) {
+        if (pixels[3 * i] != 0) {
+            fprintf(stderr, "pixel %d got red %d\n", i, pixels[3 * i]);
+            failed = 1;
+        }
+    }
+    if (!failed && (pixels[1] != 0 || pixels[3 * (WIDTH * HEIGHT) - 2] != 255 || pixels[2] != 0 ||
+                    pixels[3 * (WIDTH * HEIGHT) - 1] != 255)) {
+        fprintf(stderr, "green and blue aren't stretched to [0, 255]\n");
+        failed = 1;
+    }
+    return failed;
+}
+
+int main(void) {
+    int failed = 0;
+    for (int min = 0; min < LEVELS_LUT_SIZE; ++min) {
+        for (int max = 0; max < LEVELS_LUT_SIZE; ++max) {
+            failed += max > min ? check_stretch(min, max) : check_flat(min, max);
+        }
+    }
+    failed += check_flat_channel();
+
+    if (failed == 0)
+        printf("auto levels stretch every range and keep flat ones\n");
+    return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,63 @@
+#ifndef RESAMPLE_H
+#define RESAMPLE_H
+
+#include <stddef.h>
+
+#include "picture.h"
+#include "transfer.h"
+#include "thread_pool.h"
+
+// a box reduction leaves at least this much minification to the filter
+#define RESAMPLE_BOX_GAP 3.0
+
+typedef enum {
+    FILTER_LANCZOS3,
+    FILTER_BC_SPLINE
+} filter_type;
+
+typedef struct {
+    filter_type type;
+    // B and C of the bc-spline, unused by lanczos3
+    double b;
+    double c;
+} resample_filter;
+
+// half width of the filter window in source pixels
+int filter_radius(const resample_filter *filter);
+
+double filter_weight(const resample_filter *filter, double x);
+
+// integer factor of the box stage that runs before the filter on big reductions, 1 if there is none
+int resample_reduction(size_t source, size_t output);
+
+// the source samples behind every output sample along one axis. when minifying the kernel is stretched by the
+// reduction ratio, so it averages everything that falls into the output sample. all windows have the same
+// length, are shifted inside the picture near the borders and get zero weights for the samples the kernel
+// doesn't reach, so the inner loops run without bounds checks
+typedef struct {
+    size_t count;
+    int taps;
+    // first source sample of every window
+    int *first;
+    // count rows of taps normalised weights
+    float *weights;
+} resample_axis;
+
+// source counts samples before the box stage, the windows index samples after it
+int resample_axis_init(resample_axis *axis, const resample_filter *filter, size_t source, size_t output,
+                       int reduction);
+
+void resample_axis_free(resample_axis *axis);
+
+// decodes pic to linear light, averaged over reduce_x x reduce_y blocks
+void resample_decode(thread_pool *pool, const transfer *t, const picture *pic, int reduce_x, int reduce_y,
+                     float *linear);
+
+// scales pic to width x height with a separable filter: every source row is filtered horizontally into an
+// intermediate buffer, then the columns of that buffer are filtered vertically. pixel centres are matched, so
+// output pixel x sits at (x + 0.5) * source / output - 0.5. the output rows are split into one band per
+// thread and every band filters the source rows it needs itself, so the result doesn't depend on the threads
+picture *resample(thread_pool *pool, const picture *pic, size_t width, size_t height, float gamma,
+                  const resample_filter *filter);
+
+#endif
@@ -0,0 +1,36 @@
+#ifndef RESAMPLE_KERNELS_H
+#define RESAMPLE_KERNELS_H
+
+#include <stddef.h>
+
+#include "resample.h"
+
+// filters one source row of packed channels 1 or 3 samples into columns->count output pixels
+typedef void (*resample_horizontal_func)(const resample_axis *columns, const float *source, int channels,
+                                         float *row);
+
+// output sample x is the weighted sum of source[t * stride + x] over taps rows
+typedef void (*resample_vertical_func)(const float *source, size_t stride, const float *weights, int taps,
+                                       float *row, size_t count);
+
+// the vector kernels add the products tap by tap in the same order as the scalar ones, without fma,
+// so all of them give the same bits
+void resample_horizontal_scalar(const resample_axis *columns, const float *source, int channels, float *row);
+
+// gray rows take 8 output pixels at once and gather their windows tap by tap, rgb pixels fill 3 lanes of
+// a 128-bit vector per tap
+void resample_horizontal_avx2(const resample_axis *columns, const float *source, int channels, float *row);
+
+// avx2 if the running cpu has it, else scalar
+resample_horizontal_func resample_horizontal_kernel(void);
+
+void resample_vertical_scalar(const float *source, size_t stride, const float *weights, int taps, float *row,
+                              size_t count);
+
+void resample_vertical_avx2(const float *source, size_t stride, const float *weights, int taps, float *row,
+                            size_t count);
+
+// same choice as resample_horizontal_kernel
+resample_vertical_func resample_vertical_kernel(void);
+
+#endif
@@ -0,0 +1,25 @@
+#ifndef TRANSFER_H
+#define TRANSFER_H
+
+#include <stddef.h>
+
+#define TRANSFER_STEPS 4096
+
+// tables between 8-bit samples and linear light in [0, 1]. gamma 0 stands for sRGB, any other gamma for
+// linear = (sample / 255) ^ gamma
+typedef struct {
+    float decode[256];
+    // linear value from which a sample rounds to i + 1
+    float thresholds[255];
+    // the smallest sample over every 1 / TRANSFER_STEPS part of [0, 1], a starting point for the thresholds
+    unsigned char coarse[TRANSFER_STEPS + 1];
+} transfer;
+
+void transfer_init(transfer *t, double gamma);
+
+void transfer_decode(const transfer *t, const unsigned char *data, float *linear, size_t count);
+
+// rounds to the nearest sample, values outside [0, 1] are clamped
+void transfer_encode(const transfer *t, const float *linear, unsigned char *data, size_t count);
+
+#endif
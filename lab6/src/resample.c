@@ -0,0 +1,286 @@
+#include <stdlib.h>
+#include <math.h>
+
+#include "../include/resample.h"
+#include "../include/resample_kernels.h"
+#include "../include/transfer.h"
+#include "../include/thread_pool.h"
+#include "../include/defines.h"
+
+#define ROWS_GRAIN_PIXELS 65536
+
+static double sinc(double x) {
+    x = (x * M_PI);
+    if (x < 0.01 && x > -0.01)
+        return 1.0 + x * x * (-1.0 / 6.0 + x * x * 1.0 / 120.0);
+    return sin(x) / x;
+}
+
+static double lanczos3_kernel(double x) {
+    if (fabs(x) < 3) {
+        return sinc(x) * sinc(x / 3);
+    } else {
+        return 0.0;
+    }
+}
+
+static double bcsplines_kernel(double x, double b, double c) {
+    x = fabs(x);
+    if (x < 1) {
+        return ((12 - 9 * b - 6 * c) * x * x * x + (-18 + 12 * b + 6 * c) * x * x + (6 - 2 * b)) / 6.;
+    } else if (x < 2) {
+        return ((-b - 6 * c) * x * x * x + (6 * b + 30 * c) * x * x + (-12 * b - 48 * c) * x + (8 * b + 24 * c)) / 6.;
+    } else {
+        return 0.0;
+    }
+}
+
+int filter_radius(const resample_filter *filter) {
+    return filter->type == FILTER_LANCZOS3 ? 3 : 2;
+}
+
+double filter_weight(const resample_filter *filter, double x) {
+    return filter->type == FILTER_LANCZOS3 ? lanczos3_kernel(x) : bcsplines_kernel(x, filter->b, filter->c);
+}
+
+int resample_reduction(size_t source, size_t output) {
+    const double ratio = (double) source / output;
+    return ratio >= 2 * RESAMPLE_BOX_GAP ? (int) (ratio / RESAMPLE_BOX_GAP) : 1;
+}
+
+int resample_axis_init(resample_axis *axis, const resample_filter *filter, size_t source, size_t output,
+                       int reduction) {
+    const size_t size = (source + reduction - 1) / reduction;
+    // the box stage keeps block centres where they were, so the output centres only change units
+    const double ratio = (double) source / reduction / output;
+    const double scale = ratio > 1 ? ratio : 1;
+    const double support = filter_radius(filter) * scale;
+
+    axis->count = output;
+    axis->taps = (size_t) ceil(2 * support) < size ? (int) ceil(2 * support) : (int) size;
+    axis->first = malloc(output * sizeof(int));
+    axis->weights = malloc(output * axis->taps * sizeof(float));
+    if (!axis->first || !axis->weights) {
+        resample_axis_free(axis);
+        return NOMEM;
+    }
+
+    for (size_t x = 0; x < output; ++x) {
+        const double centre = (x + 0.5) * ratio - 0.5;
+        int first = (int) floor(centre - support) + 1;
+        if (first > (int) size - axis->taps)
+            first = (int) size - axis->taps;
+        if (first < 0)
+            first = 0;
+
+        float *weights = axis->weights + x * axis->taps;
+        double sum = 0;
+        for (int t = 0; t < axis->taps; ++t) {
+            const double weight = filter_weight(filter, (centre - (first + t)) / scale);
+            weights[t] = weight;
+            sum += weight;
+        }
+        for (int t = 0; t < axis->taps; ++t) {
+            weights[t] /= sum;
+        }
+        axis->first[x] = first;
+    }
+    return SUCCESS;
+}
+
+void resample_axis_free(resample_axis *axis) {
+    free(axis->weights);
+    free(axis->first);
+    axis->weights = NULL;
+    axis->first = NULL;
+}
+
+typedef struct {
+    const transfer *t;
+    const picture *pic;
+    int channels;
+    int reduce_x;
+    int reduce_y;
+    float *linear;
+} decode_job;
+
+// decodes rows [begin, end) of the reduced picture, each averages reduce_x x reduce_y blocks of the source.
+// the blocks on the right and bottom borders may be cut
+static void decode_rows(void *context, size_t begin, size_t end) {
+    const decode_job *job = context;
+    const picture *pic = job->pic;
+    const int channels = job->channels;
+    const size_t reduce_x = job->reduce_x;
+    const size_t reduce_y = job->reduce_y;
+    const size_t width = (pic->width + reduce_x - 1) / reduce_x;
+    const size_t row_size = width * channels;
+    if (reduce_x == 1 && reduce_y == 1) {
+        transfer_decode(job->t, pic->data + begin * row_size, job->linear + begin * row_size,
+                        (end - begin) * row_size);
+        return;
+    }
+
+    for (size_t y = begin; y < end; ++y) {
+        float *row = job->linear + y * row_size;
+        for (size_t x = 0; x < row_size; ++x) {
+            row[x] = 0;
+        }
+
+        const size_t last = (y + 1) * reduce_y < pic->height ? (y + 1) * reduce_y : pic->height;
+        for (size_t source_y = y * reduce_y; source_y < last; ++source_y) {
+            const unsigned char *source = pic->data + source_y * pic->width * channels;
+            for (size_t x = 0; x < pic->width; ++x) {
+                float *block = row + x / reduce_x * channels;
+                for (int i = 0; i < channels; ++i) {
+                    block[i] += job->t->decode[source[x * channels + i]];
+                }
+            }
+        }
+
+        const size_t block_height = last - y * reduce_y;
+        for (size_t x = 0; x < width; ++x) {
+            const size_t block_width = (x + 1) * reduce_x < pic->width ? reduce_x : pic->width - x * reduce_x;
+            const float share = 1.f / (float) (block_width * block_height);
+            for (int i = 0; i < channels; ++i) {
+                row[x * channels + i] *= share;
+            }
+        }
+    }
+}
+
+void resample_decode(thread_pool *pool, const transfer *t, const picture *pic, int reduce_x, int reduce_y,
+                     float *linear) {
+    decode_job job = {
+            .t = t,
+            .pic = pic,
+            .channels = pic->type == P5 ? 1 : 3,
+            .reduce_x = reduce_x,
+            .reduce_y = reduce_y,
+            .linear = linear
+    };
+    const size_t height = (pic->height + reduce_y - 1) / reduce_y;
+    const size_t row_pixels = pic->width * reduce_y;
+    parallel_for(pool, height, row_pixels >= ROWS_GRAIN_PIXELS ? 1 : ROWS_GRAIN_PIXELS / row_pixels,
+                 decode_rows, &job);
+}
+
+typedef struct {
+    const resample_axis *columns;
+    const resample_axis *rows;
+    const float *linear;
+    size_t source_width;
+    int channels;
+    size_t row_size;
+    size_t bands;
+    // every band owns the filtered rows it reads and one output row, from band_starts[band] on
+    float *buffers;
+    const size_t *band_starts;
+    resample_horizontal_func horizontal;
+    resample_vertical_func vertical;
+    const transfer *t;
+    unsigned char *data;
+} resample_job;
+
+static size_t band_row(const resample_job *job, size_t band) {
+    return band * job->rows->count / job->bands;
+}
+
+// filters only the source rows under the output rows of the band, neighbouring bands share a few of them
+static void resample_bands(void *context, size_t begin, size_t end) {
+    const resample_job *job = context;
+    const size_t row_size = job->row_size;
+    for (size_t band = begin; band < end; ++band) {
+        const size_t first_row = band_row(job, band);
+        const size_t last_row = band_row(job, band + 1);
+        if (first_row == last_row)
+            continue;
+
+        const size_t source_begin = job->rows->first[first_row];
+        const size_t source_end = job->rows->first[last_row - 1] + job->rows->taps;
+        float *buffer = job->buffers + job->band_starts[band];
+        float *output = buffer + (source_end - source_begin) * row_size;
+
+        for (size_t y = source_begin; y < source_end; ++y) {
+            job->horizontal(job->columns, job->linear + y * job->source_width * job->channels, job->channels,
+                            buffer + (y - source_begin) * row_size);
+        }
+        for (size_t y = first_row; y < last_row; ++y) {
+            job->vertical(buffer + (job->rows->first[y] - source_begin) * row_size, row_size,
+                          job->rows->weights + y * job->rows->taps, job->rows->taps, output, row_size);
+            transfer_encode(job->t, output, job->data + y * row_size, row_size);
+        }
+    }
+}
+
+picture *resample(thread_pool *pool, const picture *pic, size_t width, size_t height, float gamma,
+                  const resample_filter *filter) {
+    const int channels = pic->type == P5 ? 1 : 3;
+    const int reduce_x = resample_reduction(pic->width, width);
+    const int reduce_y = resample_reduction(pic->height, height);
+    const size_t source_width = (pic->width + reduce_x - 1) / reduce_x;
+    const size_t source_height = (pic->height + reduce_y - 1) / reduce_y;
+    const size_t row_size = width * channels;
+    const size_t bands = (size_t) thread_pool_threads(pool) < height ? (size_t) thread_pool_threads(pool) : height;
+    transfer t;
+    resample_axis columns = {};
+    resample_axis rows = {};
+    picture *result = malloc(sizeof(picture) + row_size * height);
+    float *linear = malloc(source_width * source_height * channels * sizeof(float));
+    size_t *band_starts = malloc(bands * sizeof(size_t));
+    float *buffers = NULL;
+    if (!result || !linear || !band_starts ||
+        resample_axis_init(&columns, filter, pic->width, width, reduce_x) != SUCCESS ||
+        resample_axis_init(&rows, filter, pic->height, height, reduce_y) != SUCCESS) {
+        goto error;
+    }
+    result->height = height;
+    result->width = width;
+    result->type = pic->type;
+    result->max_color = pic->max_color;
+    result->pixel_size = pic->pixel_size;
+
+    resample_job job = {
+            .columns = &columns,
+            .rows = &rows,
+            .source_width = source_width,
+            .channels = channels,
+            .row_size = row_size,
+            .bands = bands,
+            .band_starts = band_starts,
+            .horizontal = resample_horizontal_kernel(),
+            .vertical = resample_vertical_kernel(),
+            .t = &t,
+            .data = result->data
+    };
+    size_t buffers_size = 0;
+    for (size_t band = 0; band < bands; ++band) {
+        const size_t first_row = band_row(&job, band);
+        const size_t last_row = band_row(&job, band + 1);
+        band_starts[band] = buffers_size;
+        if (first_row < last_row)
+            buffers_size += (rows.first[last_row - 1] + rows.taps - rows.first[first_row] + 1) * row_size;
+    }
+    buffers = malloc(buffers_size * sizeof(float));
+    if (!buffers)
+        goto error;
+
+    // the filters run in linear light, every source sample is decoded once
+    transfer_init(&t, gamma);
+    resample_decode(pool, &t, pic, reduce_x, reduce_y, linear);
+
+    job.linear = linear;
+    job.buffers = buffers;
+    parallel_for(pool, bands, 1, resample_bands, &job);
+    goto cleanup;
+
+    error:
+    free(result);
+    result = NULL;
+    cleanup:
+    resample_axis_free(&rows);
+    resample_axis_free(&columns);
+    free(buffers);
+    free(band_starts);
+    free(linear);
+    return result;
+}
@@ -0,0 +1,149 @@
+#include <stdint.h>
+
+#include "../include/resample_kernels.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define X86_KERNELS 1
+#include <immintrin.h>
+#endif
+
+static void horizontal_scalar(const resample_axis *columns, const float *source, int channels, float *row,
+                              size_t begin) {
+    for (size_t x = begin; x < columns->count; ++x) {
+        const float *weights = columns->weights + x * columns->taps;
+        const float *window = source + columns->first[x] * channels;
+        for (int i = 0; i < channels; ++i) {
+            float sum = 0;
+            for (int t = 0; t < columns->taps; ++t) {
+                sum += window[t * channels + i] * weights[t];
+            }
+            row[x * channels + i] = sum;
+        }
+    }
+}
+
+void resample_horizontal_scalar(const resample_axis *columns, const float *source, int channels, float *row) {
+    horizontal_scalar(columns, source, channels, row, 0);
+}
+
+void resample_vertical_scalar(const float *source, size_t stride, const float *weights, int taps, float *row,
+                              size_t count) {
+    for (size_t x = 0; x < count; ++x) {
+        float sum = 0;
+        for (int t = 0; t < taps; ++t) {
+            sum += source[t * stride + x] * weights[t];
+        }
+        row[x] = sum;
+    }
+}
+
+#ifdef X86_KERNELS
+
+__attribute__((target("avx2")))
+void resample_horizontal_avx2(const resample_axis *columns, const float *source, int channels, float *row) {
+    const int taps = columns->taps;
+    size_t x = 0;
+    if (channels == 1) {
+        const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+        for (; x + 8 <= columns->count; x += 8) {
+            __m256i window = _mm256_loadu_si256((const __m256i *) (columns->first + x));
+            __m256i weight = _mm256_mullo_epi32(_mm256_add_epi32(_mm256_set1_epi32((int32_t) x), lanes),
+                                                _mm256_set1_epi32(taps));
+            const __m256i step = _mm256_set1_epi32(1);
+            __m256 sum = _mm256_setzero_ps();
+            for (int t = 0; t < taps; ++t) {
+                const __m256 s = _mm256_i32gather_ps(source, window, 4);
+                const __m256 w = _mm256_i32gather_ps(columns->weights, weight, 4);
+                sum = _mm256_add_ps(sum, _mm256_mul_ps(s, w));
+                window = _mm256_add_epi32(window, step);
+                weight = _mm256_add_epi32(weight, step);
+            }
+            _mm256_storeu_ps(row + x, sum);
+        }
+    } else if (channels == 3) {
+        // the fourth lane picks up the next pixel and is dropped, only the last tap could read past the row
+        const __m128i mask = _mm_setr_epi32(-1, -1, -1, 0);
+        for (; x < columns->count; ++x) {
+            const float *weights = columns->weights + x * taps;
+            const float *window = source + columns->first[x] * 3;
+            __m128 sum = _mm_setzero_ps();
+            int t = 0;
+            for (; t + 1 < taps; ++t) {
+                sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(window + t * 3), _mm_broadcast_ss(weights + t)));
+            }
+            sum = _mm_add_ps(sum, _mm_mul_ps(_mm_maskload_ps(window + t * 3, mask), _mm_broadcast_ss(weights + t)));
+            _mm_maskstore_ps(row + x * 3, mask, sum);
+        }
+    }
+    horizontal_scalar(columns, source, channels, row, x);
+}
+
+__attribute__((target("avx2")))
+void resample_vertical_avx2(const float *source, size_t stride, const float *weights, int taps, float *row,
+                            size_t count) {
+    size_t x = 0;
+    for (; x + 32 <= count; x += 32) {
+        __m256 sum0 = _mm256_setzero_ps();
+        __m256 sum1 = _mm256_setzero_ps();
+        __m256 sum2 = _mm256_setzero_ps();
+        __m256 sum3 = _mm256_setzero_ps();
+        for (int t = 0; t < taps; ++t) {
+            const float *s = source + t * stride + x;
+            const __m256 w = _mm256_broadcast_ss(weights + t);
+            sum0 = _mm256_add_ps(sum0, _mm256_mul_ps(_mm256_loadu_ps(s), w));
+            sum1 = _mm256_add_ps(sum1, _mm256_mul_ps(_mm256_loadu_ps(s + 8), w));
+            sum2 = _mm256_add_ps(sum2, _mm256_mul_ps(_mm256_loadu_ps(s + 16), w));
+            sum3 = _mm256_add_ps(sum3, _mm256_mul_ps(_mm256_loadu_ps(s + 24), w));
+        }
+        _mm256_storeu_ps(row + x, sum0);
+        _mm256_storeu_ps(row + x + 8, sum1);
+        _mm256_storeu_ps(row + x + 16, sum2);
+        _mm256_storeu_ps(row + x + 24, sum3);
+    }
+    for (; x + 8 <= count; x += 8) {
+        __m256 sum = _mm256_setzero_ps();
+        for (int t = 0; t < taps; ++t) {
+            sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_loadu_ps(source + t * stride + x),
+                                                   _mm256_broadcast_ss(weights + t)));
+        }
+        _mm256_storeu_ps(row + x, sum);
+    }
+    resample_vertical_scalar(source + x, stride, weights, taps, row + x, count - x);
+}
+
+resample_horizontal_func resample_horizontal_kernel(void) {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return resample_horizontal_avx2;
+    }
+    return resample_horizontal_scalar;
+}
+
+resample_vertical_func resample_vertical_kernel(void) {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return resample_vertical_avx2;
+    }
+    return resample_vertical_scalar;
+}
+
+#else
+
+void resample_horizontal_avx2(const resample_axis *columns, const float *source, int channels, float *row) {
+    resample_horizontal_scalar(columns, source, channels, row);
+}
+
+void resample_vertical_avx2(const float *source, size_t stride, const float *weights, int taps, float *row,
+                            size_t count) {
+    resample_vertical_scalar(source, stride, weights, taps, row, count);
+}
+
+resample_horizontal_func resample_horizontal_kernel(void) {
+    return resample_horizontal_scalar;
+}
+
+resample_vertical_func resample_vertical_kernel(void) {
+    return resample_vertical_scalar;
+}
+
+#endif
@@ -8,45 +8,39 @@
 #include "../include/defines.h"
 #include "../include/picture.h"
 #include "../include/utility.h"
+#include "../include/resample.h"
+#include "../include/transfer.h"
+#include "../include/thread_pool.h"
 
-picture *nearest_neighbourd(const picture *pic, int width, int height) {
-    picture *result = malloc(sizeof(picture) + (pic->type == P5 ? 1 : 3) * width * height);
-    if (!result) {
-        return NULL;
-    }
-    result->height = height;
-    result->width = width;
-    result->type = pic->type;
-    result->max_color = pic->max_color;
-    result->pixel_size = pic->pixel_size;
+#define ROWS_GRAIN_PIXELS 65536
 
-    int x_ratio = (int) ((pic->width << 16) / width) + 1;
-    int y_ratio = (int) ((pic->height << 16) / height) + 1;
+static size_t rows_grain(size_t width) {
+    return width >= ROWS_GRAIN_PIXELS ? 1 : ROWS_GRAIN_PIXELS / width;
+}
+
+typedef struct {
+    const picture *pic;
+    picture *result;
+    int x_ratio;
+    int y_ratio;
+} nearest_job;
+
+static void nearest_rows(void *context, size_t begin, size_t end) {
+    const nearest_job *job = context;
+    const picture *pic = job->pic;
     int x2, y2;
-    for (int y = 0; y < height; y++) {
-        for (int x = 0; x < width; x++) {
+    for (int y = begin; y < (int) end; y++) {
+        for (int x = 0; x < (int) job->result->width; x++) {
             for (int i = 0; i < (pic->type == P5 ? 1 : 3); ++i) {
-                x2 = ((x * x_ratio) >> 16);
-                y2 = ((y * y_ratio) >> 16);
-                get_data(result, x, y)[i] = const_get_data(pic, x2, y2)[i];
+                x2 = ((x * job->x_ratio) >> 16);
+                y2 = ((y * job->y_ratio) >> 16);
+                get_data(job->result, x, y)[i] = const_get_data(pic, x2, y2)[i];
             }
         }
     }
-    return result;
-}
-
-unsigned char bilinear_approx(const float dx,
-                              const float dy,
-                              const unsigned char c00,
-                              const unsigned char c10,
-                              const unsigned char c01,
-                              const unsigned char c11) {
-    float a = c00 * (1 - dx) + c10 * dx;
-    float b = c01 * (1 - dx) + c11 * dx;
-    return a * (1 - dy) + b * dy;
 }
 
-picture *bilinear_interpolation(const picture *pic, int width, int height, float gamma) {
+picture *nearest_neighbourd(thread_pool *pool, const picture *pic, int width, int height) {
     picture *result = malloc(sizeof(picture) + (pic->type == P5 ? 1 : 3) * width * height);
     if (!result) {
         return NULL;
@@ -57,7 +51,41 @@ picture *bilinear_interpolation(const picture *pic, int width, int height, float
     result->max_color = pic->max_color;
     result->pixel_size = pic->pixel_size;
 
-    for (int y = 0; y < height; y++) {
+    nearest_job job = {
+            .pic = pic,
+            .result = result,
+            .x_ratio = (int) ((pic->width << 16) / width) + 1,
+            .y_ratio = (int) ((pic->height << 16) / height) + 1
+    };
+    parallel_for(pool, height, rows_grain(width), nearest_rows, &job);
+    return result;
+}
+
+float bilinear_approx(const float dx,
+                      const float dy,
+                      const float c00,
+                      const float c10,
+                      const float c01,
+                      const float c11) {
+    float a = c00 * (1 - dx) + c10 * dx;
+    float b = c01 * (1 - dx) + c11 * dx;
+    return a * (1 - dy) + b * dy;
+}
+
+typedef struct {
+    const picture *pic;
+    picture *result;
+    const float *linear;
+    const transfer *t;
+} bilinear_job;
+
+static void bilinear_rows(void *context, size_t begin, size_t end) {
+    const bilinear_job *job = context;
+    const picture *pic = job->pic;
+    const int width = job->result->width;
+    const int height = job->result->height;
+    const int channels = pic->type == P5 ? 1 : 3;
+    for (int y = begin; y < (int) end; y++) {
         for (int x = 0; x < width; x++) {
             double gx = x / (double) (width) * (pic->width - 1);
             double gy = y / (double) (height) * (pic->height - 1);
@@ -67,44 +95,27 @@ picture *bilinear_interpolation(const picture *pic, int width, int height, float
 
             const int x_2 = x_ + 1 >= pic->width ? x_ : x_ + 1;
             const int y_2 = y_ + 1 >= pic->height ? y_ : y_ + 1;
-            const unsigned char *pixel_c00 = const_get_data(pic, x_, y_);
-            const unsigned char *pixel_c10 = const_get_data(pic, x_2, y_);
-            const unsigned char *pixel_c01 = const_get_data(pic, x_, y_2);
-            const unsigned char *pixel_c11 = const_get_data(pic, x_2, y_2);
-
-            for (int i = 0; i < (pic->type == P5 ? 1 : 3); ++i) {
-                get_data(result, x, y)[i] = gamma_correction(bilinear_approx(gx - x_,
-                                                                             gy - y_,
-                                                                             gamma_back_correction(pixel_c00[i], gamma),
-                                                                             gamma_back_correction(pixel_c10[i], gamma),
-                                                                             gamma_back_correction(pixel_c01[i], gamma),
-                                                                             gamma_back_correction(pixel_c11[i], gamma)
-                ), gamma);
+            const float *pixel_c00 = job->linear + (y_ * pic->width + x_) * channels;
+            const float *pixel_c10 = job->linear + (y_ * pic->width + x_2) * channels;
+            const float *pixel_c01 = job->linear + (y_2 * pic->width + x_) * channels;
+            const float *pixel_c11 = job->linear + (y_2 * pic->width + x_2) * channels;
+
+            float pixel[3];
+            for (int i = 0; i < channels; ++i) {
+                pixel[i] = bilinear_approx(gx - x_, gy - y_, pixel_c00[i], pixel_c10[i], pixel_c01[i], pixel_c11[i]);
             }
+            transfer_encode(job->t, pixel, get_data(job->result, x, y), channels);
         }
     }
-
-    return result;
-}
-
-double sinc(double x) {
-    x = (x * M_PI);
-    if (x < 0.01 && x > -0.01)
-        return 1.0 + x * x * (-1.0 / 6.0 + x * x * 1.0 / 120.0);
-    return sin(x) / x;
-}
-
-double lanczos3_kernel(double x) {
-    if (fabs(x) < 3) {
-        return sinc(x) * sinc(x / 3);
-    } else {
-        return 0.0;
-    }
 }
 
-picture *lanczos_3(const picture *pic, int width, int height, float gamma) {
-    picture *result = malloc(sizeof(picture) + (pic->type == P5 ? 1 : 3) * width * height);
-    if (!result) {
+picture *bilinear_interpolation(thread_pool *pool, const picture *pic, int width, int height, float gamma) {
+    const int channels = pic->type == P5 ? 1 : 3;
+    picture *result = malloc(sizeof(picture) + channels * width * height);
+    float *linear = malloc(pic->width * pic->height * channels * sizeof(float));
+    if (!result || !linear) {
+        free(linear);
+        free(result);
         return NULL;
     }
     result->height = height;
@@ -113,102 +124,46 @@ picture *lanczos_3(const picture *pic, int width, int height, float gamma) {
     result->max_color = pic->max_color;
     result->pixel_size = pic->pixel_size;
 
-    const int lanczos_size = 3;
-
-    const float width_ratio =
-            (float) pic->width / width;
-    const float height_ratio =
-            (float) pic->height / height;
-
-    for (int y = 0; y < height; y++) {
-        for (int x = 0; x < width; x++) {
-            const int old_x = width_ratio * x;
-            const int old_y = height_ratio * y;
+    transfer t;
+    transfer_init(&t, gamma);
+    resample_decode(pool, &t, pic, 1, 1, linear);
 
-            for (int i = 0; i < (pic->type == P5 ? 1 : 3); ++i) {
-                float sum = 0;
-                float weight = 0;
-                for (int x_ = old_x - lanczos_size + 1; x_ <= old_x + lanczos_size; ++x_) {
-                    for (int y_ = old_y - lanczos_size + 1; y_ <= old_y + lanczos_size; ++y_) {
-                        if (x_ >= 0 && x_ < pic->width && y_ >= 0 && y_ < pic->height) {
-                            const double lanc_coef =
-                                    lanczos3_kernel(height_ratio * y - y_) * lanczos3_kernel(width_ratio * x - x_);
-                            sum += gamma_back_correction(const_get_data(pic, x_, y_)[i], gamma) / 255. * lanc_coef;
-                            weight += lanc_coef;
-                        }
-                    }
-                }
-                const float pix_res = fmaxf(0.f, fminf(1.f, sum / weight));
-                get_data(result, x, y)[i] = gamma_correction(pix_res * 255.f, gamma);
-            }
-        }
-    }
+    bilinear_job job = {.pic = pic, .result = result, .linear = linear, .t = &t};
+    parallel_for(pool, height, rows_grain(width), bilinear_rows, &job);
 
+    free(linear);
     return result;
 }
 
-double bcsplines_kernel(double x, double b, double c) {
-    if (fabsf(x) < 1) {
-        return ((12 - 9 * b - 6 * c) * pow(fabs(x), 3) + (-18 + 12 * b + 6 * c) * pow(fabs(x), 2) + (6 - 2 * b)) / 6.;
-    } else if (fabsf(x) < 2) {
-        return ((-b - 6 * c) * pow(fabs(x), 3) + (6 * b + 30 * c) * pow(fabs(x), 2) + (-12 * b - 48 * c) * fabs(x) +
-               (8 * b + 24 * c)) / 6.;
-    } else {
-        return 0.0;
-    }
+picture *lanczos_3(thread_pool *pool, const picture *pic, int width, int height, float gamma) {
+    const resample_filter filter = {.type = FILTER_LANCZOS3};
+    return resample(pool, pic, width, height, gamma, &filter);
 }
 
-picture *bcsplines(const picture *pic, int width, int height, float gamma, float b, float c) {
-    picture *result = malloc(sizeof(picture) + (pic->type == P5 ? 1 : 3) * width * height);
-    if (!result) {
-        return NULL;
-    }
-    result->height = height;
-    result->width = width;
-    result->type = pic->type;
-    result->max_color = pic->max_color;
-    result->pixel_size = pic->pixel_size;
-
-    const int radius = 2;
-
-    const float width_ratio =
-            (float) pic->width / width;
-    const float height_ratio =
-            (float) pic->height / height;
-
-    for (int y = 0; y < height; y++) {
-        for (int x = 0; x < width; x++) {
-            const int old_x = width_ratio * x;
-            const int old_y = height_ratio * y;
-
+picture *bcsplines(thread_pool *pool, const picture *pic, int width, int height, float gamma, float b, float c) {
+    const resample_filter filter = {.type = FILTER_BC_SPLINE, .b = b, .c = c};
+    return resample(pool, pic, width, height, gamma, &filter);
+}
 
-            for (int i = 0; i < (pic->type == P5 ? 1 : 3); ++i) {
-                float sum = 0;
-                float weight = 0;
-                for (int x_ = old_x - radius - 1; x_ <= old_x + radius; ++x_) {
-                    for (int y_ = old_y - radius - 1; y_ <= old_y + radius; ++y_) {
-                        if (x_ >= 0 && x_ < pic->width && y_ >= 0 && y_ < pic->height) {
-                            const double bcs_1 = bcsplines_kernel(height_ratio * y - y_, b, c);
-                            const double bcs_2 = bcsplines_kernel(width_ratio * x - x_, b, c);
-                            const double bcs_coef = bcs_1 * bcs_2;
-                            sum += gamma_back_correction(const_get_data(pic, x_, y_)[i], gamma) / 255. * bcs_coef;
-                            weight += bcs_coef;
-                        }
-                    }
-                }
-                const float pix_res = fmaxf(0.f, fminf(1.f, sum / weight));
-                get_data(result, x, y)[i] = gamma_correction(pix_res * 255.f, gamma);
-            }
+int task2(int argc, char *argv[]) {
+    int threads = default_thread_count();
+    thread_pool *pool = NULL;
+    // trailing options, the positional arguments stay in place
+    while (argc >= 3 && !strcmp(argv[argc - 2], "-j")) {
+        READ_INT(threads, argv[argc - 1], {
+            perror("error in parsing <threads>.");
+            return EXIT_FAILURE;
+        }, strtol);
+        if (threads < 1) {
+            fprintf(stderr, "threads must be positive");
+            return EXIT_FAILURE;
         }
+        argc -= 2;
     }
 
-    return result;
-}
-
-int task2(int argc, char *argv[]) {
     if (argc != 9 && argc != 11) {
         fprintf(stderr,
-                "usage:\n%s <input> <output> <width> <height> <dx> <dy> <gamma> <type> [<B> <C>]\n",
+                "usage:\n%s <input> <output> <width> <height> <dx> <dy> <gamma> <type> [<B> <C>] [-j <threads>]\n",
                 argv[0]);
         return EXIT_FAILURE;
     }
@@ -319,9 +274,15 @@ int task2(int argc, char *argv[]) {
            picture->height * picture->width * picture->pixel_size * (picture->type == P5 ? 1 : 3));
     free(data);
 
+    pool = thread_pool_create(threads);
+    if (!pool) {
+        fprintf(stderr, "NOMEM: can't create thread pool.");
+        goto error;
+    }
+
     switch (type) {
         case 0: {
-            struct picture *temp = nearest_neighbourd(picture, width, height);
+            struct picture *temp = nearest_neighbourd(pool, picture, width, height);
             if (temp == NULL) {
                 perror("can't allocate memory for result image.");
                 goto error;
@@ -331,7 +292,7 @@ int task2(int argc, char *argv[]) {
             break;
         }
         case 1: {
-            struct picture *temp = bilinear_interpolation(picture, width, height, gamma);
+            struct picture *temp = bilinear_interpolation(pool, picture, width, height, gamma);
             if (temp == NULL) {
                 perror("can't allocate memory for result image.");
                 goto error;
@@ -341,7 +302,7 @@ int task2(int argc, char *argv[]) {
             break;
         }
         case 2: {
-            struct picture *temp = lanczos_3(picture, width, height, gamma);
+            struct picture *temp = lanczos_3(pool, picture, width, height, gamma);
             if (temp == NULL) {
                 perror("can't allocate memory for result image.");
                 goto error;
@@ -363,7 +324,7 @@ int task2(int argc, char *argv[]) {
                     goto error;
                 }, strtod);
             }
-            struct picture *temp = bcsplines(picture, width, height, gamma, b, c);
+            struct picture *temp = bcsplines(pool, picture, width, height, gamma, b, c);
             if (temp == NULL) {
                 perror("can't allocate memory for result image.");
                 goto error;
@@ -396,12 +357,14 @@ int task2(int argc, char *argv[]) {
     }
 
     clear:
+    thread_pool_destroy(pool);
     fclose(input_file);
     fclose(output_file);
     free(picture);
     return EXIT_SUCCESS;
 
     error:
+    thread_pool_destroy(pool);
     free(picture);
     error_close_files:
     fclose(output_file);
@@ -0,0 +1,44 @@
+#include <math.h>
+
+#include "../include/transfer.h"
+
+static double to_linear(double value, double gamma) {
+    if (gamma == 0)
+        return value <= 0.04045 ? value / 12.92 : pow((value + 0.055) / 1.055, 2.4);
+    return pow(value, gamma);
+}
+
+void transfer_init(transfer *t, double gamma) {
+    for (int i = 0; i < 256; ++i) {
+        t->decode[i] = to_linear(i / 255., gamma);
+    }
+    for (int i = 0; i < 255; ++i) {
+        t->thresholds[i] = to_linear((i + 0.5) / 255., gamma);
+    }
+
+    int sample = 0;
+    for (int i = 0; i <= TRANSFER_STEPS; ++i) {
+        const float value = (float) i / TRANSFER_STEPS;
+        while (sample < 255 && value >= t->thresholds[sample]) {
+            ++sample;
+        }
+        t->coarse[i] = sample;
+    }
+}
+
+void transfer_decode(const transfer *t, const unsigned char *data, float *linear, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        linear[i] = t->decode[data[i]];
+    }
+}
+
+void transfer_encode(const transfer *t, const float *linear, unsigned char *data, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        const float value = fmaxf(0.f, fminf(1.f, linear[i]));
+        int sample = t->coarse[(int) (value * TRANSFER_STEPS)];
+        while (sample < 255 && value >= t->thresholds[sample]) {
+            ++sample;
+        }
+        data[i] = sample;
+    }
+}
@@ -0,0 +1,194 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include "../include/resample_kernels.h"
+#include "../include/resample.h"
+#include "../include/defines.h"
+
+// 8 fills one gather or vertical vector, the others leave a part of one or end in the middle of the second
+static const int tap_counts[] = {1, 3, 4, 6, 8, 9, 13, 24};
+// none of the odd ones is a multiple of 8 or 32, so every call ends in a scalar tail
+static const size_t counts[] = {1, 5, 8, 13, 31, 32, 33, 45, 64, 100};
+
+static unsigned int seed = 12345;
+
+static float random_float(float low, float high) {
+    seed = seed * 1103515245u + 12345u;
+    return low + (high - low) * (float) (seed >> 8) / (float) (1u << 24);
+}
+
+// floats that end right before an inaccessible page where mmap is available, so a read past the end crashes
+typedef struct {
+    float *data;
+    void *base;
+    size_t bytes;
+} guarded;
+
+static int guarded_alloc(guarded *g, size_t count) {
+#ifdef __linux__
+    const size_t page = sysconf(_SC_PAGESIZE);
+    g->bytes = (count * sizeof(float) + page - 1) / page * page + page;
+    g->base = mmap(NULL, g->bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (g->base == MAP_FAILED)
+        return NOMEM;
+    unsigned char *guard = (unsigned char *) g->base + g->bytes - page;
+    if (mprotect(guard, page, PROT_NONE) != 0) {
+        munmap(g->base, g->bytes);
+        return NOMEM;
+    }
+    g->data = (float *) guard - count;
+#else
+    g->bytes = count * sizeof(float);
+    g->base = malloc(g->bytes);
+    if (!g->base)
+        return NOMEM;
+    g->data = g->base;
+#endif
+    for (size_t i = 0; i < count; ++i) {
+        g->data[i] = random_float(0.f, 1.f);
+    }
+    return SUCCESS;
+}
+
+static void guarded_free(guarded *g) {
+#ifdef __linux__
+    munmap(g->base, g->bytes);
+#else
+    free(g->base);
+#endif
+}
+
+static int compare_horizontal(const resample_axis *columns, size_t source, int channels, const char *what) {
+    guarded row;
+    float *expected = malloc(columns->count * channels * sizeof(float));
+    float *actual = malloc(columns->count * channels * sizeof(float));
+    if (!expected || !actual || guarded_alloc(&row, source * channels) != SUCCESS) {
+        fprintf(stderr, "no mem\n");
+        free(expected);
+        free(actual);
+        return 1;
+    }
+
+    resample_horizontal_scalar(columns, row.data, channels, expected);
+    resample_horizontal_avx2(columns, row.data, channels, actual);
+    const int failed = memcmp(expected, actual, columns->count * channels * sizeof(float)) != 0;
+    if (failed)
+        fprintf(stderr, "horizontal %s, %d channels, %d taps, %zu pixels differ\n", what, channels, columns->taps,
+                columns->count);
+
+    guarded_free(&row);
+    free(expected);
+    free(actual);
+    return failed;
+}
+
+// random windows and weights, the last window ends at the last source pixel
+static int check_horizontal(int channels, int taps, size_t count) {
+    const size_t source = count + taps + 2;
+    resample_axis columns = {.count = count, .taps = taps};
+    columns.first = malloc(count * sizeof(int));
+    columns.weights = malloc(count * taps * sizeof(float));
+    if (!columns.first || !columns.weights) {
+        fprintf(stderr, "no mem\n");
+        resample_axis_free(&columns);
+        return 1;
+    }
+    for (size_t x = 0; x < count; ++x) {
+        columns.first[x] = x + 1 == count ? (int) (source - taps) : (int) random_float(0.f, source - taps + 1);
+        for (int t = 0; t < taps; ++t) {
+            columns.weights[x * taps + t] = random_float(-0.25f, 1.f);
+        }
+    }
+
+    const int failed = compare_horizontal(&columns, source, channels, "random windows");
+    resample_axis_free(&columns);
+    return failed;
+}
+
+// the windows the resampler builds itself, shifted to the borders and with zero weights at their ends
+static int check_filter_axis(const resample_filter *filter, size_t source, size_t output) {
+    const int reduction = resample_reduction(source, output);
+    resample_axis columns;
+    if (resample_axis_init(&columns, filter, source, output, reduction) != SUCCESS) {
+        fprintf(stderr, "no mem\n");
+        return 1;
+    }
+
+    const size_t size = (source + reduction - 1) / reduction;
+    int failed = compare_horizontal(&columns, size, 1, "filter axis");
+    failed += compare_horizontal(&columns, size, 3, "filter axis");
+    resample_axis_free(&columns);
+    return failed;
+}
+
+// the last tap row ends at the end of the buffer, strides longer than a row are tried too
+static int check_vertical(int taps, size_t count, size_t padding) {
+    const size_t stride = count + padding;
+    guarded source;
+    float *weights = malloc(taps * sizeof(float));
+    float *expected = malloc(count * sizeof(float));
+    float *actual = malloc(count * sizeof(float));
+    if (!weights || !expected || !actual || guarded_alloc(&source, (taps - 1) * stride + count) != SUCCESS) {
+        fprintf(stderr, "no mem\n");
+        free(weights);
+        free(expected);
+        free(actual);
+        return 1;
+    }
+    for (int t = 0; t < taps; ++t) {
+        weights[t] = random_float(-0.25f, 1.f);
+    }
+
+    resample_vertical_scalar(source.data, stride, weights, taps, expected, count);
+    resample_vertical_avx2(source.data, stride, weights, taps, actual, count);
+    const int failed = memcmp(expected, actual, count * sizeof(float)) != 0;
+    if (failed)
+        fprintf(stderr, "vertical, %d taps, %zu columns, stride %zu differ\n", taps, count, stride);
+
+    guarded_free(&source);
+    free(weights);
+    free(expected);
+    free(actual);
+    return failed;
+}
+
+int main(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (!__builtin_cpu_supports("avx2")) {
+        printf("no avx2, nothing to compare\n");
+        return EXIT_SUCCESS;
+    }
+#else
+    printf("no vector kernels, nothing to compare\n");
+    return EXIT_SUCCESS;
+#endif
+
+    int failed = 0;
+    for (size_t t = 0; t < sizeof(tap_counts) / sizeof(tap_counts[0]); ++t) {
+        for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); ++c) {
+            failed += check_horizontal(1, tap_counts[t], counts[c]);
+            failed += check_horizontal(3, tap_counts[t], counts[c]);
+            failed += check_vertical(tap_counts[t], counts[c], 0);
+            failed += check_vertical(tap_counts[t], counts[c], 7);
+        }
+    }
+
+    const resample_filter filters[] = {{FILTER_LANCZOS3}, {FILTER_BC_SPLINE, 1. / 3, 1. / 3}};
+    const size_t sizes[][2] = {{100, 37}, {37, 100}, {5, 3}, {3, 17}, {1000, 13}, {641, 97}};
+    for (size_t f = 0; f < sizeof(filters) / sizeof(filters[0]); ++f) {
+        for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s) {
+            failed += check_filter_axis(&filters[f], sizes[s][0], sizes[s][1]);
+        }
+    }
+
+    if (failed == 0)
+        printf("avx2 resampling kernels bit-exact with the scalar ones\n");
+    return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}